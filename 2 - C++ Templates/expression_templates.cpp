@@ -0,0 +1,278 @@
+// 在 templated_functions.cpp 中，add<T>(a, b) 把两个值相加并返回结果。
+// 如果把它用在数组上，计算 a + b + c 就需要先算出 add(a, b) 这个完整的临时数组，
+// 再把它和 c 相加得到另一个完整的数组。表达式有 k 项，就要分配 k - 1 个临时数组，
+// 并把所有数据在内存中来回读写 k - 1 遍。
+
+// "表达式模板"（expression templates）是一种利用模板延迟求值的技巧：
+// a + b 不立即计算，而是返回一个很小的对象 BinaryExpr<Add, Vec, Vec>，它只记住两个操作数；
+// (a + b) + c 的类型是 BinaryExpr<Add, BinaryExpr<Add, Vec, Vec>, Vec>，
+// 整个表达式的结构被编码在类型中，在编译时就已经确定。
+// 只有当表达式被赋值给一个 Vec 时，才在一个融合的循环中一次性计算出结果，不需要任何临时数组。
+
+// 对于有 SIMD 内核（见 simd_kernels.h）的元素类型，我们按缓存友好的小块求值：
+// 每次取 256 个元素，表达式树中的每个节点用 SIMD 内核把这一小块算出来，放在栈上的缓冲区中。
+// 这些小缓冲区一直留在 L1 缓存中，所以效果和一个手写的融合循环相当，同时用上了更宽的指令。
+// 形如 x * y + z 的子表达式会被识别出来，用一次 fma 完成。
+// 对于其他元素类型，按元素逐个求值：result[i] = expr[i]。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::initializer_list。
+#include <initializer_list>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::true_type、std::false_type。
+#include <type_traits>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含本目录中的 SIMD 内核。
+#include "simd_kernels.h"
+
+// 分块求值时每块的元素个数。
+constexpr size_t kBlock = 256;
+
+// 所有表达式（包括 Vec 本身）的基类。它使用"奇异递归模板模式"（CRTP）：
+// 派生类把自己作为模板参数传给基类，这样基类可以在编译时把 *this 转换成派生类，
+// 不需要虚函数。operator+ 等运算符只接受 VecExpr<E>，因此不会误匹配其他类型。
+template <typename E> struct VecExpr {
+  const E &self() const { return static_cast<const E &>(*this); }
+};
+
+template <typename T> class Vec;
+
+// 表达式节点保存操作数的方式：Vec 按引用保存（避免拷贝数据），
+// 表达式节点本身很小，按值保存（因为它们通常是临时对象，在整个表达式结束时就被销毁）。
+template <typename E> struct operand {
+  using type = const E;
+};
+template <typename T> struct operand<Vec<T>> {
+  using type = const Vec<T> &;
+};
+
+template <simd::Op O, typename L, typename R>
+class BinaryExpr : public VecExpr<BinaryExpr<O, L, R>> {
+public:
+  using value_type = typename L::value_type;
+
+  BinaryExpr(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {
+    if (lhs.size() != rhs.size()) {
+      throw std::invalid_argument("vector sizes do not match");
+    }
+  }
+
+  size_t size() const { return lhs_.size(); }
+
+  // 逐元素求值。x * y + z 和 eval_block 一样用一次 fma 完成，
+  // 这样 expr[i] 和赋值得到的结果逐位相同。
+  value_type operator[](size_t i) const {
+    if constexpr (O == simd::Op::Add && is_mul<L>::value) {
+      return simd::scalar_apply<simd::Op::Fma>(lhs_.lhs()[i], lhs_.rhs()[i], rhs_[i]);
+    } else if constexpr (O == simd::Op::Add && is_mul<R>::value) {
+      return simd::scalar_apply<simd::Op::Fma>(rhs_.lhs()[i], rhs_.rhs()[i], lhs_[i]);
+    } else {
+      return simd::scalar_apply<O>(lhs_[i], rhs_[i], value_type());
+    }
+  }
+
+  // 分块求值：计算 [offset, offset + n) 这一块，结果写入 buf，并返回指向结果的指针。
+  const value_type *eval_block(size_t offset, size_t n, value_type *buf) const {
+    value_type lbuf[kBlock], rbuf[kBlock];
+    if constexpr (O == simd::Op::Add && is_mul<L>::value) {
+      // x * y + z：左边的乘法不单独计算，和加法一起用 fma 完成。
+      value_type cbuf[kBlock];
+      const value_type *x = lhs_.lhs().eval_block(offset, n, lbuf);
+      const value_type *y = lhs_.rhs().eval_block(offset, n, rbuf);
+      const value_type *z = rhs_.eval_block(offset, n, cbuf);
+      simd::dispatch<simd::Op::Fma>(x, y, z, buf, n);
+    } else if constexpr (O == simd::Op::Add && is_mul<R>::value) {
+      // z + x * y：同上，加法满足交换律。
+      value_type cbuf[kBlock];
+      const value_type *x = rhs_.lhs().eval_block(offset, n, lbuf);
+      const value_type *y = rhs_.rhs().eval_block(offset, n, rbuf);
+      const value_type *z = lhs_.eval_block(offset, n, cbuf);
+      simd::dispatch<simd::Op::Fma>(x, y, z, buf, n);
+    } else {
+      const value_type *x = lhs_.eval_block(offset, n, lbuf);
+      const value_type *y = rhs_.eval_block(offset, n, rbuf);
+      simd::dispatch<O>(x, y, static_cast<const value_type *>(nullptr), buf, n);
+    }
+    return buf;
+  }
+
+  const L &lhs() const { return lhs_; }
+  const R &rhs() const { return rhs_; }
+
+private:
+  template <typename E> struct is_mul : std::false_type {};
+  template <typename A, typename B>
+  struct is_mul<BinaryExpr<simd::Op::Mul, A, B>> : std::true_type {};
+
+  typename operand<L>::type lhs_;
+  typename operand<R>::type rhs_;
+};
+
+template <typename L, typename R>
+BinaryExpr<simd::Op::Add, L, R> operator+(const VecExpr<L> &lhs, const VecExpr<R> &rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+template <typename L, typename R>
+BinaryExpr<simd::Op::Sub, L, R> operator-(const VecExpr<L> &lhs, const VecExpr<R> &rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+template <typename L, typename R>
+BinaryExpr<simd::Op::Mul, L, R> operator*(const VecExpr<L> &lhs, const VecExpr<R> &rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+// 真正拥有数据的向量。只有在从表达式构造或赋值时，才会发生计算。
+template <typename T> class Vec : public VecExpr<Vec<T>> {
+public:
+  using value_type = T;
+
+  explicit Vec(size_t n, T value = T()) : data_(n, value) {}
+  Vec(std::initializer_list<T> values) : data_(values) {}
+
+  template <typename E> Vec(const VecExpr<E> &expr) : data_(expr.self().size()) {
+    assign(expr.self());
+  }
+
+  template <typename E> Vec &operator=(const VecExpr<E> &expr) {
+    if (expr.self().size() != size()) {
+      throw std::invalid_argument("vector sizes do not match");
+    }
+    assign(expr.self());
+    return *this;
+  }
+
+  size_t size() const { return data_.size(); }
+  T operator[](size_t i) const { return data_[i]; }
+  T &operator[](size_t i) { return data_[i]; }
+  const T *data() const { return data_.data(); }
+
+  // 叶子节点的一块就是自己的数据，不需要拷贝。
+  const T *eval_block(size_t offset, size_t, T *) const { return data_.data() + offset; }
+
+private:
+  // 表达式是逐元素的，第 i 个结果只依赖于各个操作数的第 i 个元素，
+  // 所以即使目标 Vec 同时出现在表达式中（a = a + b），直接写入也是安全的。
+  template <typename E> void assign(const E &expr) {
+    size_t n = size();
+    if constexpr (simd::has_simd<T>) {
+      for (size_t offset = 0; offset < n; offset += kBlock) {
+        size_t len = n - offset < kBlock ? n - offset : kBlock;
+        T *dst = data_.data() + offset;
+        const T *result = expr.eval_block(offset, len, dst);
+        if (result != dst) {
+          std::memcpy(dst, result, len * sizeof(T));
+        }
+      }
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        data_[i] = expr[i];
+      }
+    }
+  }
+
+  std::vector<T> data_;
+};
+
+// 对照组：像 add<T> 一样，每次运算都返回一个新的完整数组（内部同样使用 SIMD 内核）。
+template <simd::Op O, typename T>
+std::vector<T> naive(const std::vector<T> &a, const std::vector<T> &b) {
+  std::vector<T> out(a.size());
+  simd::dispatch<O>(a.data(), b.data(), static_cast<const T *>(nullptr), out.data(), a.size());
+  return out;
+}
+
+template <typename T> std::vector<T> operator+(const std::vector<T> &a, const std::vector<T> &b) {
+  return naive<simd::Op::Add>(a, b);
+}
+template <typename T> std::vector<T> operator-(const std::vector<T> &a, const std::vector<T> &b) {
+  return naive<simd::Op::Sub>(a, b);
+}
+template <typename T> std::vector<T> operator*(const std::vector<T> &a, const std::vector<T> &b) {
+  return naive<simd::Op::Mul>(a, b);
+}
+
+// 对一个 3 ~ 6 项的表达式，分别用临时数组（std::vector）和表达式模板（Vec）计算 reps 次。
+template <typename NaiveFn, typename FusedFn>
+void benchmark(const char *name, size_t n, int reps, NaiveFn naive_fn, FusedFn fused_fn,
+               double &checksum) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  for (int r = 0; r < reps; ++r) {
+    checksum += naive_fn()[r % n];
+  }
+  std::chrono::duration<double, std::milli> naive_ms = Clock::now() - start;
+
+  start = Clock::now();
+  for (int r = 0; r < reps; ++r) {
+    checksum += fused_fn()[r % n];
+  }
+  std::chrono::duration<double, std::milli> fused_ms = Clock::now() - start;
+
+  std::cout << "  " << name << ": temporaries " << naive_ms.count() / reps << " ms, fused "
+            << fused_ms.count() / reps << " ms\n";
+}
+
+int main() {
+  // 首先，我们像使用普通的数值一样使用 Vec。右边的表达式在赋值时才被计算。
+  Vec<float> a = {1.0f, 2.0f, 3.0f, 4.0f};
+  Vec<float> b = {10.0f, 20.0f, 30.0f, 40.0f};
+  Vec<float> c = {0.5f, 0.5f, 0.5f, 0.5f};
+  Vec<float> result = a + b * c - a;
+  std::cout << "Printing a + b * c - a:";
+  for (size_t i = 0; i < result.size(); ++i) {
+    std::cout << " " << result[i];
+  }
+  std::cout << std::endl;
+
+  // 表达式本身只是一个很小的对象，它的类型记录了整个计算过程。
+  auto expr = a + b + c;
+  std::cout << "sizeof(a + b + c) = " << sizeof(expr) << " bytes, element 2 = " << expr[2]
+            << std::endl;
+
+  // 没有 SIMD 内核的类型按元素逐个求值，同样没有临时数组。
+  Vec<long long> x = {1, 2, 3}, y = {4, 5, 6};
+  x = x * y + x;
+  std::cout << "Printing x * y + x: " << x[0] << " " << x[1] << " " << x[2] << std::endl;
+
+  // 基准测试：n 个 float，表达式有 3 ~ 6 项。
+  const size_t n = 1 << 22;
+  const int reps = 20;
+  std::vector<std::vector<float>> in(6, std::vector<float>(n));
+  for (size_t k = 0; k < in.size(); ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      in[k][i] = static_cast<float>((i * (k + 3)) % 101) * 0.01f;
+    }
+  }
+  const auto &va = in[0], &vb = in[1], &vc = in[2], &vd = in[3], &ve = in[4], &vf = in[5];
+  Vec<float> ea(n), eb(n), ec(n), ed(n), ee(n), ef(n), out(n);
+  Vec<float> *targets[] = {&ea, &eb, &ec, &ed, &ee, &ef};
+  for (size_t k = 0; k < in.size(); ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      (*targets[k])[i] = in[k][i];
+    }
+  }
+
+  double checksum = 0;
+  std::cout << n << " floats, time per evaluation:\n";
+  benchmark("3 terms a + b * c", n, reps, [&] { return va + vb * vc; },
+            [&]() -> const Vec<float> & { return out = ea + eb * ec; }, checksum);
+  benchmark("4 terms a + b + c + d", n, reps, [&] { return va + vb + vc + vd; },
+            [&]() -> const Vec<float> & { return out = ea + eb + ec + ed; }, checksum);
+  benchmark("5 terms a * b + c * d + e", n, reps, [&] { return va * vb + vc * vd + ve; },
+            [&]() -> const Vec<float> & { return out = ea * eb + ec * ed + ee; }, checksum);
+  benchmark("6 terms a + b - c + d * e - f", n, reps, [&] { return va + vb - vc + vd * ve - vf; },
+            [&]() -> const Vec<float> & { return out = ea + eb - ec + ed * ee - ef; }, checksum);
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
@@ -0,0 +1,410 @@
+// templated_classes.cpp 中的 Foo<T>、Foo2<T, U> 和 FooSpecial<T> 只能通过 print() 输出到 std::cout。
+// 如果要把几百万个这样的对象保存到文件或者通过网络发送，逐个用 iostream 格式化成文本是很慢的：
+// 每个数字都要转换成十进制字符，读回来时还要再解析一遍。
+
+// 这个文件实现一个基于类型特征（type traits）分派的二进制序列化器：
+//   - 对于"可以按位拷贝"的类型（例如 Foo<int>、Foo2<int, float>），对象在内存中的字节就是它的编码，
+//     一整个数组只需要一次 std::memcpy；
+//   - 对于其他类型（例如包含 std::string 的 Foo2<std::string, int>），逐个字段编码；
+//   - 和 templated_classes.cpp 中的 FooSpecial<float> 一样，
+//     可以为某个具体类型提供显式特化，完全替换默认的编码方式。
+// 选择哪种实现完全在编译时完成，运行时没有任何分支或虚函数调用。
+
+// 注意：和 4 - Containers/mmap_snapshot.cpp 一样，按位拷贝的编码使用本机字节序和本机的结构体布局，
+// 所以只能在相同平台、相同编译器设置的程序之间交换数据。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::lround。
+#include <cmath>
+// 包含 int16_t、uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::ostringstream、std::istringstream。
+#include <sstream>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::is_trivially_copyable、std::enable_if、std::void_t 等类型特征。
+#include <type_traits>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 与 templated_classes.cpp 中相同的三个类模板，只是增加了读取成员的函数。
+template <typename T> class Foo {
+public:
+  Foo(T var) : var_(var) {}
+  void print() { std::cout << var_ << std::endl; }
+  const T &var() const { return var_; }
+
+private:
+  T var_;
+};
+
+template <typename T, typename U> class Foo2 {
+public:
+  Foo2(T var1, U var2) : var1_(var1), var2_(var2) {}
+  void print() { std::cout << var1_ << " and " << var2_ << std::endl; }
+  const T &var1() const { return var1_; }
+  const U &var2() const { return var2_; }
+
+private:
+  T var1_;
+  U var2_;
+};
+
+template <typename T> class FooSpecial {
+public:
+  FooSpecial(T var) : var_(var) {}
+  void print() { std::cout << var_ << std::endl; }
+  const T &var() const { return var_; }
+
+private:
+  T var_;
+};
+
+template <> class FooSpecial<float> {
+public:
+  FooSpecial(float var) : var_(var) {}
+  void print() { std::cout << "hello float! " << var_ << std::endl; }
+  float var() const { return var_; }
+
+private:
+  float var_;
+};
+
+// 输出缓冲区：序列化的结果追加到一个字节数组的末尾。
+class BinaryWriter {
+public:
+  void write_bytes(const void *data, size_t size) {
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + size);
+    std::memcpy(buffer_.data() + old_size, data, size);
+  }
+  const std::vector<char> &buffer() const { return buffer_; }
+
+private:
+  std::vector<char> buffer_;
+};
+
+// 输入视图：从一段字节中按顺序读取。读取越界时抛出 std::runtime_error，而不是读到缓冲区外面。
+class BinaryReader {
+public:
+  explicit BinaryReader(const std::vector<char> &buffer)
+      : data_(buffer.data()), remaining_(buffer.size()) {}
+
+  void read_bytes(void *out, size_t size) {
+    if (size > remaining_) {
+      throw std::runtime_error("BinaryReader: unexpected end of input");
+    }
+    std::memcpy(out, data_, size);
+    data_ += size;
+    remaining_ -= size;
+  }
+  size_t remaining() const { return remaining_; }
+
+private:
+  const char *data_;
+  size_t remaining_;
+};
+
+// 一个类型能否按位序列化。可以按位拷贝（trivially copyable）的类型满足条件，
+// 但指针除外：指针的值在另一个进程中没有意义。
+// 如果某个可以按位拷贝的类型包含指针成员，可以把这个特征特化为 false，让它走逐字段编码。
+template <typename T>
+struct is_bitwise_serializable
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                       !std::is_pointer<T>::value> {};
+
+// Serializer<T> 定义了类型 T 的编码方式。主模板没有定义，
+// 所以对一个既不能按位拷贝、也没有特化的类型进行序列化会产生编译错误。
+// 第二个模板参数只用于下面基于 std::enable_if 的偏特化。
+template <typename T, typename Enable = void> struct Serializer;
+
+// 可以按位序列化的类型：单个对象和整个数组都只需要一次 memcpy。
+template <typename T>
+struct Serializer<T, std::enable_if_t<is_bitwise_serializable<T>::value>> {
+  static void write(BinaryWriter &w, const T &value) { w.write_bytes(&value, sizeof(T)); }
+  static void write_array(BinaryWriter &w, const T *values, size_t n) {
+    w.write_bytes(values, n * sizeof(T));
+  }
+
+  // T 不一定有默认构造函数（Foo<int> 就没有），所以不能先写 T value; 再把字节拷贝进去。
+  // 我们先得到一个所有字节都是 0 的 T，再用 memcpy 覆盖它的字节，这对按位拷贝的类型是合法的。
+  static T read(BinaryReader &r) {
+    T value = blank();
+    r.read_bytes(&value, sizeof(T));
+    return value;
+  }
+  static void read_array(BinaryReader &r, std::vector<T> &out, size_t n) {
+    if (n > r.remaining() / sizeof(T)) {
+      throw std::runtime_error("BinaryReader: unexpected end of input");
+    }
+    size_t old_size = out.size();
+    out.resize(old_size + n, blank());
+    r.read_bytes(out.data() + old_size, n * sizeof(T));
+  }
+
+private:
+  static T blank() {
+    union Holder {
+      Holder() : bytes{} {}
+      unsigned char bytes[sizeof(T)];
+      T value;
+    } holder;
+    return holder.value;
+  }
+};
+
+// 字符串：先写长度，再写字节。
+template <> struct Serializer<std::string> {
+  static void write(BinaryWriter &w, const std::string &value) {
+    uint64_t size = value.size();
+    w.write_bytes(&size, sizeof(size));
+    w.write_bytes(value.data(), value.size());
+  }
+  static std::string read(BinaryReader &r) {
+    uint64_t size = 0;
+    r.read_bytes(&size, sizeof(size));
+    if (size > r.remaining()) {
+      throw std::runtime_error("BinaryReader: unexpected end of input");
+    }
+    std::string value(size, '\0');
+    r.read_bytes(&value[0], size);
+    return value;
+  }
+};
+
+// 不能按位拷贝的 Foo<T> 和 Foo2<T, U>：逐个字段编码。
+// 如果 T 和 U 都可以按位拷贝，Foo2<T, U> 本身也可以按位拷贝，会匹配上面的偏特化，而不是这个。
+template <typename T>
+struct Serializer<Foo<T>, std::enable_if_t<!is_bitwise_serializable<Foo<T>>::value>> {
+  static void write(BinaryWriter &w, const Foo<T> &value) { Serializer<T>::write(w, value.var()); }
+  static Foo<T> read(BinaryReader &r) { return Foo<T>(Serializer<T>::read(r)); }
+};
+
+template <typename T, typename U>
+struct Serializer<Foo2<T, U>, std::enable_if_t<!is_bitwise_serializable<Foo2<T, U>>::value>> {
+  static void write(BinaryWriter &w, const Foo2<T, U> &value) {
+    Serializer<T>::write(w, value.var1());
+    Serializer<U>::write(w, value.var2());
+  }
+  static Foo2<T, U> read(BinaryReader &r) {
+    // 函数参数的求值顺序是不确定的，所以必须先按顺序读出两个字段，再构造对象。
+    T var1 = Serializer<T>::read(r);
+    U var2 = Serializer<U>::read(r);
+    return Foo2<T, U>(std::move(var1), std::move(var2));
+  }
+};
+
+// 就像 FooSpecial<float> 特化了 print 一样，这里为 FooSpecial<float> 提供一个完全不同的编码：
+// 先写一个 1 字节的类型标记，再写 float 的原始字节。读取时检查标记，
+// 这样把别的数据误当作 FooSpecial<float> 读取时会抛出异常，而不是悄悄得到一个错误的值。
+// 编码是无损的：读回来的 float 和写入的每一位都相同。
+// 显式特化比上面按位拷贝的偏特化更加特化，所以它会被优先选择。
+template <> struct Serializer<FooSpecial<float>> {
+  static constexpr char kTag = 'f';
+
+  static void write(BinaryWriter &w, const FooSpecial<float> &value) {
+    float v = value.var();
+    w.write_bytes(&kTag, sizeof(kTag));
+    w.write_bytes(&v, sizeof(v));
+  }
+  static FooSpecial<float> read(BinaryReader &r) {
+    char tag = 0;
+    r.read_bytes(&tag, sizeof(tag));
+    if (tag != kTag) {
+      throw std::runtime_error("BinaryReader: bad FooSpecial<float> tag");
+    }
+    float v = 0.0f;
+    r.read_bytes(&v, sizeof(v));
+    return FooSpecial<float>(v);
+  }
+};
+
+// 有损的编码不应该是某个类型的默认编码，所以它使用一个单独的类型，需要调用者明确选择：
+// QuantizedFloat 把 [-1, 1] 范围内的值量化成 16 位定点数，只占 2 个字节。
+// 超出范围的值会被截断到 -1 或 1，范围内的值也只保留大约 4 到 5 位有效数字。
+struct QuantizedFloat {
+  float value;
+};
+
+template <> struct Serializer<QuantizedFloat> {
+  static void write(BinaryWriter &w, const QuantizedFloat &value) {
+    float v = value.value < -1.0f ? -1.0f : (value.value > 1.0f ? 1.0f : value.value);
+    int16_t q = static_cast<int16_t>(std::lround(v * 32767.0f));
+    w.write_bytes(&q, sizeof(q));
+  }
+  static QuantizedFloat read(BinaryReader &r) {
+    int16_t q = 0;
+    r.read_bytes(&q, sizeof(q));
+    return QuantizedFloat{static_cast<float>(q) / 32767.0f};
+  }
+};
+
+// 检测 Serializer<T> 是否提供整块读写（write_array）。按位拷贝的偏特化提供它，
+// 而显式特化（例如上面的 FooSpecial<float> 和 QuantizedFloat）可以不提供，这时数组会逐个元素编码。
+template <typename T, typename = void> struct has_bulk_path : std::false_type {};
+template <typename T>
+struct has_bulk_path<T, std::void_t<decltype(&Serializer<T>::write_array)>> : std::true_type {};
+
+// 数组：先写元素个数。如果有整块读写，整个数组就是一次 memcpy；否则逐个元素编码。
+template <typename T> void serialize(BinaryWriter &w, const std::vector<T> &values) {
+  uint64_t n = values.size();
+  w.write_bytes(&n, sizeof(n));
+  if constexpr (has_bulk_path<T>::value) {
+    Serializer<T>::write_array(w, values.data(), values.size());
+  } else {
+    for (const T &value : values) {
+      Serializer<T>::write(w, value);
+    }
+  }
+}
+
+template <typename T> std::vector<T> deserialize_vector(BinaryReader &r) {
+  uint64_t n = 0;
+  r.read_bytes(&n, sizeof(n));
+  std::vector<T> values;
+  if constexpr (has_bulk_path<T>::value) {
+    Serializer<T>::read_array(r, values, n);
+  } else {
+    for (uint64_t i = 0; i < n; ++i) {
+      values.push_back(Serializer<T>::read(r));
+    }
+  }
+  return values;
+}
+
+int main() {
+  // 首先，我们序列化 templated_classes.cpp 中的几个对象，再把它们读回来。
+  BinaryWriter writer;
+  Serializer<Foo<int>>::write(writer, Foo<int>(3));
+  Serializer<Foo2<int, float>>::write(writer, Foo2<int, float>(3, 3.2f));
+  Serializer<Foo2<std::string, int>>::write(writer, Foo2<std::string, int>("jignesh", 445));
+  Serializer<FooSpecial<float>>::write(writer, FooSpecial<float>(4.5f));
+  std::cout << "Serialized 4 objects into " << writer.buffer().size() << " bytes\n";
+
+  BinaryReader reader(writer.buffer());
+  std::cout << "Foo<int>: ";
+  Serializer<Foo<int>>::read(reader).print();
+  std::cout << "Foo2<int, float>: ";
+  Serializer<Foo2<int, float>>::read(reader).print();
+  std::cout << "Foo2<std::string, int>: ";
+  Serializer<Foo2<std::string, int>>::read(reader).print();
+  std::cout << "FooSpecial<float>: ";
+  Serializer<FooSpecial<float>>::read(reader).print();
+
+  // 数组的编码方式由元素类型决定：Foo<int> 整块拷贝，FooSpecial<float> 逐个写成 5 个字节，
+  // 明确选择了有损编码的 QuantizedFloat 逐个量化成 2 个字节。
+  BinaryWriter ints, floats, quantized;
+  serialize(ints, std::vector<Foo<int>>(100, Foo<int>(7)));
+  serialize(floats, std::vector<FooSpecial<float>>(100, FooSpecial<float>(0.5f)));
+  serialize(quantized, std::vector<QuantizedFloat>(100, QuantizedFloat{0.5f}));
+  std::cout << "100 x Foo<int>: " << ints.buffer().size() << " bytes, 100 x FooSpecial<float>: "
+            << floats.buffer().size() << " bytes, 100 x QuantizedFloat: "
+            << quantized.buffer().size() << " bytes\n";
+  BinaryReader float_reader(floats.buffer());
+  std::cout << "First restored FooSpecial<float>: ";
+  deserialize_vector<FooSpecial<float>>(float_reader).front().print();
+  BinaryReader quantized_reader(quantized.buffer());
+  std::cout << "First restored QuantizedFloat (lossy): "
+            << deserialize_vector<QuantizedFloat>(quantized_reader).front().value << "\n";
+
+  // 读取被截断的数据时会抛出异常。
+  try {
+    Serializer<Foo2<std::string, int>>::read(reader);
+  } catch (const std::runtime_error &e) {
+    std::cout << "Caught: " << e.what() << std::endl;
+  }
+
+  // 基准测试：n 个 Foo2<int, float>（按位拷贝）和 n 个 Foo2<std::string, int>（逐字段编码），
+  // 与 print() 那样逐个对象用 iostream 输出文本相比。
+  const size_t n = 2000000;
+  std::vector<Foo2<int, float>> pods;
+  std::vector<Foo2<std::string, int>> named;
+  for (size_t i = 0; i < n; ++i) {
+    pods.emplace_back(static_cast<int>(i), static_cast<float>(i) * 0.5f);
+    named.emplace_back("user" + std::to_string(i), static_cast<int>(i));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  auto report = [&](const char *name, Clock::time_point start, size_t bytes) {
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() << " ms, " << bytes / (1024 * 1024)
+              << " MiB, " << bytes / 1e6 / (elapsed.count() / 1000) << " MB/s\n";
+  };
+  long long checksum = 0;
+
+  std::cout << n << " x Foo2<int, float>:\n";
+  {
+    auto start = Clock::now();
+    std::ostringstream out;
+    for (const auto &foo : pods) {
+      out << foo.var1() << ' ' << foo.var2() << '\n';
+    }
+    std::string text = out.str();
+    report("iostream write", start, text.size());
+
+    start = Clock::now();
+    std::istringstream in(text);
+    int a;
+    float b;
+    while (in >> a >> b) {
+      checksum += a;
+    }
+    report("iostream read ", start, text.size());
+  }
+  {
+    auto start = Clock::now();
+    BinaryWriter w;
+    serialize(w, pods);
+    report("binary write  ", start, w.buffer().size());
+
+    start = Clock::now();
+    BinaryReader r(w.buffer());
+    auto restored = deserialize_vector<Foo2<int, float>>(r);
+    report("binary read   ", start, w.buffer().size());
+    checksum += restored.back().var1();
+  }
+
+  std::cout << n << " x Foo2<std::string, int>:\n";
+  {
+    auto start = Clock::now();
+    std::ostringstream out;
+    for (const auto &foo : named) {
+      out << foo.var1() << ' ' << foo.var2() << '\n';
+    }
+    std::string text = out.str();
+    report("iostream write", start, text.size());
+
+    start = Clock::now();
+    std::istringstream in(text);
+    std::string a;
+    int b;
+    while (in >> a >> b) {
+      checksum += b;
+    }
+    report("iostream read ", start, text.size());
+  }
+  {
+    auto start = Clock::now();
+    BinaryWriter w;
+    serialize(w, named);
+    report("binary write  ", start, w.buffer().size());
+
+    start = Clock::now();
+    BinaryReader r(w.buffer());
+    auto restored = deserialize_vector<Foo2<std::string, int>>(r);
+    report("binary read   ", start, w.buffer().size());
+    checksum += restored.back().var2();
+  }
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
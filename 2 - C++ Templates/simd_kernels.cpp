@@ -0,0 +1,139 @@
+// 在 templated_functions.cpp 中，add<T> 一次只把两个数相加。
+// 实际的数值代码往往要把两个很长的数组逐元素相加，这时一个一个地相加就浪费了 CPU 的能力：
+// 现代 x86 CPU 的一条 SIMD 指令可以同时处理 4 个（SSE2）、8 个（AVX2）或 16 个（AVX-512）float。
+
+// simd_kernels.h 提供了 simd::add、simd::sub、simd::mul 和 simd::fma 四个数组运算，
+// 它们对 float、double 和 int32_t 有 SSE2、AVX2、AVX-512 三种特化实现，
+// 程序启动时检测 CPU 支持的指令集并选择最快的一种；对于其他类型，或者在非 x86 平台上，
+// 使用通用的标量实现。这个文件演示它们的用法，并比较各个指令集的速度。
+
+// 注意：编译器在开启优化时也会自动向量化标量循环，但默认只使用所有 x86-64 CPU 都支持的 SSE2，
+// 因为它不知道程序将来会在什么 CPU 上运行。运行时分派让我们在新 CPU 上用上更宽的指令。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 int32_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::integral_constant。
+#include <type_traits>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含本目录中的 SIMD 内核。
+#include "simd_kernels.h"
+
+// 用 isa 对应的内核运行 op，并与标量结果逐元素比较，确保每个特化都是正确的。
+template <simd::Op O, typename T>
+bool matches_scalar(simd::Isa isa, const std::vector<T> &a, const std::vector<T> &b,
+                    const std::vector<T> &c) {
+  size_t n = a.size();
+  std::vector<T> expected(n), actual(n);
+  simd::scalar_kernel<O>(a.data(), b.data(), c.data(), expected.data(), n);
+  simd::kernel_for<O, T>(isa)(a.data(), b.data(), c.data(), actual.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    // 所有实现的 fma 都只舍入一次，所以结果必须逐位相同。
+    if (expected[i] != actual[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 对每种运算和每个 CPU 支持的指令集，测量在 n 个元素的数组上每个元素的平均耗时。
+template <typename T> void benchmark(const char *type_name, size_t n, long long &checksum) {
+  std::vector<T> a(n), b(n), c(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    // 浮点数的输入不是整数，乘积不能被精确表示，这样 matches_scalar 才能检查出舍入方式的不同。
+    a[i] = static_cast<T>((i % 97 + 1) * 1.1);
+    b[i] = static_cast<T>((i % 13 + 2) * 0.7);
+    c[i] = static_cast<T>((i % 7) * 0.3);
+  }
+
+  // 数组越大，重复次数越少，让每次测量处理的元素总数大致相同。
+  const size_t reps = 64 * 1024 * 1024 / n;
+  const simd::Isa isas[] = {simd::Isa::Scalar, simd::Isa::SSE2, simd::Isa::AVX2,
+                            simd::Isa::AVX512};
+
+  std::cout << type_name << ", " << n << " elements (ns/element):\n";
+  auto run = [&](const char *op_name, auto op_tag) {
+    constexpr simd::Op O = decltype(op_tag)::value;
+    std::cout << "  " << op_name;
+    for (simd::Isa isa : isas) {
+      if (!simd::cpu_supports(isa)) {
+        continue;
+      }
+      if (!matches_scalar<O>(isa, a, b, c)) {
+        std::cout << "  " << simd::isa_name(isa) << " WRONG RESULT";
+        continue;
+      }
+      auto kernel = simd::kernel_for<O, T>(isa);
+      auto start = std::chrono::steady_clock::now();
+      for (size_t r = 0; r < reps; ++r) {
+        kernel(a.data(), b.data(), c.data(), out.data(), n);
+        checksum += static_cast<long long>(out[r % n]);
+      }
+      std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << "  " << simd::isa_name(isa) << " "
+                << elapsed.count() / static_cast<double>(reps * n);
+    }
+    std::cout << "\n";
+  };
+  run("add", std::integral_constant<simd::Op, simd::Op::Add>());
+  run("sub", std::integral_constant<simd::Op, simd::Op::Sub>());
+  run("mul", std::integral_constant<simd::Op, simd::Op::Mul>());
+  run("fma", std::integral_constant<simd::Op, simd::Op::Fma>());
+}
+
+int main() {
+  std::cout << "Best instruction set on this CPU: " << simd::isa_name(simd::best_isa()) << "\n";
+
+  // 首先，像 templated_functions.cpp 中的 add<int> 和 add<float> 一样调用数组版本。
+  // simd::add 会自动使用当前 CPU 上最快的实现。
+  std::vector<float> x = {2.8f, 1.0f, 0.5f, 4.0f, 3.0f};
+  std::vector<float> y = {3.7f, 2.0f, 0.5f, 1.0f, 7.0f};
+  std::vector<float> sum(x.size());
+  simd::add<float>(x, y, sum);
+  std::cout << "Printing simd::add<float>(x, y):";
+  for (float v : sum) {
+    std::cout << " " << v;
+  }
+  std::cout << std::endl;
+
+  std::vector<int32_t> i1 = {3, 4, 5}, i2 = {5, 6, 7}, i3 = {1, 1, 1};
+  std::vector<int32_t> iout(3);
+  simd::fma<int32_t>(i1, i2, i3, iout);
+  std::cout << "Printing simd::fma<int32_t>(i1, i2, i3):";
+  for (int32_t v : iout) {
+    std::cout << " " << v;
+  }
+  std::cout << std::endl;
+
+  // 没有 SIMD 特化的类型（比如 long long）使用通用的标量实现。
+  std::vector<long long> l1 = {1, 2}, l2 = {10, 20}, lout(2);
+  simd::mul<long long>(l1, l2, lout);
+  std::cout << "Printing simd::mul<long long>(l1, l2): " << lout[0] << " " << lout[1] << std::endl;
+
+  // 输入和输出的长度不一致时抛出 std::invalid_argument。
+  try {
+    std::vector<float> shorter(2);
+    simd::sub<float>(x, shorter, sum);
+  } catch (const std::invalid_argument &e) {
+    std::cout << "Caught: " << e.what() << std::endl;
+  }
+
+  // 基准测试：4K 个元素（数据在 L1/L2 缓存中，受计算速度限制）
+  // 和 4M 个元素（数据在内存中，受内存带宽限制，更宽的指令帮助不大）。
+  long long checksum = 0;
+  for (size_t n : {size_t(4096), size_t(4) * 1024 * 1024}) {
+    benchmark<float>("float", n, checksum);
+    benchmark<double>("double", n, checksum);
+    benchmark<int32_t>("int32_t", n, checksum);
+  }
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
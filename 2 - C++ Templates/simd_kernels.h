@@ -0,0 +1,399 @@
+// 这个头文件把 templated_functions.cpp 中的 add<T> 从"两个标量相加"推广到"两个数组逐元素运算"，
+// 并为常见的元素类型提供 SIMD（单指令多数据）实现。
+// 它被 simd_kernels.cpp 和 expression_templates.cpp 共同使用。
+
+// 基本思路与 templated_functions.cpp 中的 print_msg<float> 相同：
+// 先写一个对任何类型都适用的通用模板（这里是逐元素的标量循环），
+// 再为特定的类型提供显式特化（这里是 VecTraits<float, Isa::AVX2> 等）。
+// 不同之处在于，选择哪个特化不是在编译时决定的，而是在程序启动时根据 CPU 支持的指令集决定的：
+// 同一个可执行文件可以在只支持 SSE2 的老机器上运行，也可以在支持 AVX-512 的新机器上跑得更快。
+
+// 为了做到这一点，我们不使用 -mavx2 这样的全局编译选项，
+// 而是用 GCC/Clang 的 __attribute__((target("..."))) 只为特定的函数开启对应的指令集。
+// 这些函数只有在 CPU 检测确认支持之后才会被调用。
+// 在非 x86 平台（例如 ARM 上的 macOS）上，所有运算都退回到标量实现。
+
+#pragma once
+
+// 包含 std::fma。
+#include <cmath>
+// 包含 int32_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::is_same、std::is_signed 等类型特征。
+#include <type_traits>
+// 包含 std::vector。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOOTCAMP_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define BOOTCAMP_SIMD_X86 0
+#endif
+
+namespace simd {
+
+// C++17 中还没有 std::span（C++20 才加入），所以这里定义一个最小的"视图"类型：
+// 它只是一个指针加一个长度，不拥有内存，可以从 std::vector 隐式构造。
+template <typename T> struct Span {
+  Span(T *ptr, size_t count) : data(ptr), size(count) {}
+  template <typename U>
+  Span(std::vector<U> &vec) : data(vec.data()), size(vec.size()) {}
+  template <typename U>
+  Span(const std::vector<U> &vec) : data(vec.data()), size(vec.size()) {}
+
+  T *data;
+  size_t size;
+};
+
+// 支持的指令集，按从弱到强排列。
+enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+inline const char *isa_name(Isa isa) {
+  switch (isa) {
+  case Isa::SSE2:
+    return "SSE2";
+  case Isa::AVX2:
+    return "AVX2";
+  case Isa::AVX512:
+    return "AVX-512";
+  default:
+    return "scalar";
+  }
+}
+
+// 检测当前 CPU 是否支持某个指令集。AVX2 的实现同时使用 FMA 指令，所以两者都要检查。
+inline bool cpu_supports(Isa isa) {
+#if BOOTCAMP_SIMD_X86
+  __builtin_cpu_init();
+  switch (isa) {
+  case Isa::SSE2:
+    return __builtin_cpu_supports("sse2");
+  case Isa::AVX2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case Isa::AVX512:
+    return __builtin_cpu_supports("avx512f");
+  default:
+    return true;
+  }
+#else
+  return isa == Isa::Scalar;
+#endif
+}
+
+// 当前 CPU 支持的最强指令集。只在第一次调用时检测一次。
+inline Isa best_isa() {
+  static const Isa best = []() {
+    for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE2}) {
+      if (cpu_supports(isa)) {
+        return isa;
+      }
+    }
+    return Isa::Scalar;
+  }();
+  return best;
+}
+
+// 逐元素运算的种类。Fma 计算 a * b + c。
+enum class Op { Add, Sub, Mul, Fma };
+
+// 标量版本的单个元素运算。有符号整数按无符号数计算，
+// 这样溢出时和 SIMD 指令一样按 2 的补码回绕，而不是未定义行为。
+// 浮点数的 Fma 用 std::fma，和 AVX2、AVX-512 的融合乘加指令一样只舍入一次，
+// 所以无论选中哪个指令集，结果都逐位相同。
+template <Op O, typename T> inline T scalar_apply(T a, T b, T c) {
+  if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+    using U = typename std::make_unsigned<T>::type;
+    U ua = static_cast<U>(a), ub = static_cast<U>(b), uc = static_cast<U>(c);
+    if constexpr (O == Op::Add) {
+      return static_cast<T>(ua + ub);
+    } else if constexpr (O == Op::Sub) {
+      return static_cast<T>(ua - ub);
+    } else if constexpr (O == Op::Mul) {
+      return static_cast<T>(ua * ub);
+    } else {
+      return static_cast<T>(ua * ub + uc);
+    }
+  } else {
+    if constexpr (O == Op::Add) {
+      return a + b;
+    } else if constexpr (O == Op::Sub) {
+      return a - b;
+    } else if constexpr (O == Op::Mul) {
+      return a * b;
+    } else if constexpr (std::is_floating_point<T>::value) {
+      return std::fma(a, b, c);
+    } else {
+      return a * b + c;
+    }
+  }
+}
+
+// 通用的标量内核，适用于任何元素类型。对于不需要 c 的运算，c 可以是 nullptr。
+template <Op O, typename T>
+void scalar_kernel(const T *a, const T *b, const T *c, T *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = scalar_apply<O>(a[i], b[i], c != nullptr ? c[i] : T());
+  }
+}
+
+// VecTraits<T, I> 描述了元素类型 T 在指令集 I 上的向量寄存器类型和基本运算。
+// 主模板故意不定义，只有下面显式特化过的组合才能使用 SIMD。
+template <typename T, Isa I> struct VecTraits;
+
+// has_simd<T> 表示 T 是否有 SIMD 特化。
+template <typename T>
+constexpr bool has_simd = std::is_same<T, float>::value || std::is_same<T, double>::value ||
+                          std::is_same<T, int32_t>::value;
+
+#if BOOTCAMP_SIMD_X86
+
+#define BOOTCAMP_SSE2 __attribute__((target("sse2"), always_inline))
+#define BOOTCAMP_AVX2 __attribute__((target("avx2,fma"), always_inline))
+#define BOOTCAMP_AVX512 __attribute__((target("avx512f"), always_inline))
+
+// ---- SSE2：128 位寄存器 ----
+
+template <> struct VecTraits<float, Isa::SSE2> {
+  using Vec = __m128;
+  static constexpr size_t kWidth = 4;
+  BOOTCAMP_SSE2 static Vec load(const float *p) { return _mm_loadu_ps(p); }
+  BOOTCAMP_SSE2 static void store(float *p, Vec v) { _mm_storeu_ps(p, v); }
+  BOOTCAMP_SSE2 static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+  BOOTCAMP_SSE2 static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+  BOOTCAMP_SSE2 static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+  // SSE2 没有融合乘加指令。先乘再加会舍入两次，结果可能和其他指令集在最后一位上不同，
+  // 所以逐个元素调用 std::fma。这比较慢，但只有不支持 AVX2 的老 CPU 才会用到这个实现。
+  BOOTCAMP_SSE2 static Vec fma(Vec a, Vec b, Vec c) {
+    alignas(16) float x[kWidth], y[kWidth], z[kWidth];
+    _mm_store_ps(x, a);
+    _mm_store_ps(y, b);
+    _mm_store_ps(z, c);
+    for (size_t i = 0; i < kWidth; ++i) {
+      x[i] = std::fma(x[i], y[i], z[i]);
+    }
+    return _mm_load_ps(x);
+  }
+};
+
+template <> struct VecTraits<double, Isa::SSE2> {
+  using Vec = __m128d;
+  static constexpr size_t kWidth = 2;
+  BOOTCAMP_SSE2 static Vec load(const double *p) { return _mm_loadu_pd(p); }
+  BOOTCAMP_SSE2 static void store(double *p, Vec v) { _mm_storeu_pd(p, v); }
+  BOOTCAMP_SSE2 static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+  BOOTCAMP_SSE2 static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+  BOOTCAMP_SSE2 static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+  // 和上面的 float 一样，逐个元素调用 std::fma。
+  BOOTCAMP_SSE2 static Vec fma(Vec a, Vec b, Vec c) {
+    alignas(16) double x[kWidth], y[kWidth], z[kWidth];
+    _mm_store_pd(x, a);
+    _mm_store_pd(y, b);
+    _mm_store_pd(z, c);
+    for (size_t i = 0; i < kWidth; ++i) {
+      x[i] = std::fma(x[i], y[i], z[i]);
+    }
+    return _mm_load_pd(x);
+  }
+};
+
+template <> struct VecTraits<int32_t, Isa::SSE2> {
+  using Vec = __m128i;
+  static constexpr size_t kWidth = 4;
+  BOOTCAMP_SSE2 static Vec load(const int32_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+  BOOTCAMP_SSE2 static void store(int32_t *p, Vec v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+  }
+  BOOTCAMP_SSE2 static Vec add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+  BOOTCAMP_SSE2 static Vec sub(Vec a, Vec b) { return _mm_sub_epi32(a, b); }
+  // SSE2 没有 32 位整数的低位乘法指令（SSE4.1 才有 _mm_mullo_epi32），
+  // 这里用两次 32x32->64 位乘法分别计算偶数和奇数位置，再把低 32 位拼起来。
+  BOOTCAMP_SSE2 static Vec mul(Vec a, Vec b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  }
+  BOOTCAMP_SSE2 static Vec fma(Vec a, Vec b, Vec c) { return add(mul(a, b), c); }
+};
+
+// ---- AVX2：256 位寄存器 ----
+
+template <> struct VecTraits<float, Isa::AVX2> {
+  using Vec = __m256;
+  static constexpr size_t kWidth = 8;
+  BOOTCAMP_AVX2 static Vec load(const float *p) { return _mm256_loadu_ps(p); }
+  BOOTCAMP_AVX2 static void store(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+  BOOTCAMP_AVX2 static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+  BOOTCAMP_AVX2 static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+  BOOTCAMP_AVX2 static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+  BOOTCAMP_AVX2 static Vec fma(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+};
+
+template <> struct VecTraits<double, Isa::AVX2> {
+  using Vec = __m256d;
+  static constexpr size_t kWidth = 4;
+  BOOTCAMP_AVX2 static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+  BOOTCAMP_AVX2 static void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+  BOOTCAMP_AVX2 static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+  BOOTCAMP_AVX2 static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+  BOOTCAMP_AVX2 static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+  BOOTCAMP_AVX2 static Vec fma(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+};
+
+template <> struct VecTraits<int32_t, Isa::AVX2> {
+  using Vec = __m256i;
+  static constexpr size_t kWidth = 8;
+  BOOTCAMP_AVX2 static Vec load(const int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  BOOTCAMP_AVX2 static void store(int32_t *p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  BOOTCAMP_AVX2 static Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+  BOOTCAMP_AVX2 static Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+  BOOTCAMP_AVX2 static Vec mul(Vec a, Vec b) { return _mm256_mullo_epi32(a, b); }
+  BOOTCAMP_AVX2 static Vec fma(Vec a, Vec b, Vec c) { return add(mul(a, b), c); }
+};
+
+// ---- AVX-512：512 位寄存器 ----
+
+template <> struct VecTraits<float, Isa::AVX512> {
+  using Vec = __m512;
+  static constexpr size_t kWidth = 16;
+  BOOTCAMP_AVX512 static Vec load(const float *p) { return _mm512_loadu_ps(p); }
+  BOOTCAMP_AVX512 static void store(float *p, Vec v) { _mm512_storeu_ps(p, v); }
+  BOOTCAMP_AVX512 static Vec add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+  BOOTCAMP_AVX512 static Vec sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+  BOOTCAMP_AVX512 static Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+  BOOTCAMP_AVX512 static Vec fma(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+};
+
+template <> struct VecTraits<double, Isa::AVX512> {
+  using Vec = __m512d;
+  static constexpr size_t kWidth = 8;
+  BOOTCAMP_AVX512 static Vec load(const double *p) { return _mm512_loadu_pd(p); }
+  BOOTCAMP_AVX512 static void store(double *p, Vec v) { _mm512_storeu_pd(p, v); }
+  BOOTCAMP_AVX512 static Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+  BOOTCAMP_AVX512 static Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+  BOOTCAMP_AVX512 static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+  BOOTCAMP_AVX512 static Vec fma(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+};
+
+template <> struct VecTraits<int32_t, Isa::AVX512> {
+  using Vec = __m512i;
+  static constexpr size_t kWidth = 16;
+  BOOTCAMP_AVX512 static Vec load(const int32_t *p) { return _mm512_loadu_si512(p); }
+  BOOTCAMP_AVX512 static void store(int32_t *p, Vec v) { _mm512_storeu_si512(p, v); }
+  BOOTCAMP_AVX512 static Vec add(Vec a, Vec b) { return _mm512_add_epi32(a, b); }
+  BOOTCAMP_AVX512 static Vec sub(Vec a, Vec b) { return _mm512_sub_epi32(a, b); }
+  BOOTCAMP_AVX512 static Vec mul(Vec a, Vec b) { return _mm512_mullo_epi32(a, b); }
+  BOOTCAMP_AVX512 static Vec fma(Vec a, Vec b, Vec c) { return add(mul(a, b), c); }
+};
+
+// 每个指令集一个循环模板。循环本身也必须带上相同的 target 属性，
+// 否则编译器不允许把上面的向量运算内联进来。
+// 循环先按向量宽度处理主体部分，剩下不足一个向量的尾部用标量处理。
+#define BOOTCAMP_DEFINE_SIMD_KERNEL(NAME, TARGET)                                                  \
+  template <Op O, typename T, typename Tr>                                                         \
+  __attribute__((target(TARGET))) void NAME(const T *a, const T *b, const T *c, T *out,            \
+                                            size_t n) {                                            \
+    size_t i = 0;                                                                                  \
+    for (; i + Tr::kWidth <= n; i += Tr::kWidth) {                                                 \
+      typename Tr::Vec va = Tr::load(a + i);                                                       \
+      typename Tr::Vec vb = Tr::load(b + i);                                                       \
+      if constexpr (O == Op::Add) {                                                                \
+        Tr::store(out + i, Tr::add(va, vb));                                                       \
+      } else if constexpr (O == Op::Sub) {                                                         \
+        Tr::store(out + i, Tr::sub(va, vb));                                                       \
+      } else if constexpr (O == Op::Mul) {                                                         \
+        Tr::store(out + i, Tr::mul(va, vb));                                                       \
+      } else {                                                                                     \
+        Tr::store(out + i, Tr::fma(va, vb, Tr::load(c + i)));                                     \
+      }                                                                                            \
+    }                                                                                              \
+    scalar_kernel<O>(a + i, b + i, c != nullptr ? c + i : nullptr, out + i, n - i);                \
+  }
+
+BOOTCAMP_DEFINE_SIMD_KERNEL(sse2_kernel, "sse2")
+BOOTCAMP_DEFINE_SIMD_KERNEL(avx2_kernel, "avx2,fma")
+BOOTCAMP_DEFINE_SIMD_KERNEL(avx512_kernel, "avx512f")
+
+#undef BOOTCAMP_DEFINE_SIMD_KERNEL
+#undef BOOTCAMP_SSE2
+#undef BOOTCAMP_AVX2
+#undef BOOTCAMP_AVX512
+
+#endif // BOOTCAMP_SIMD_X86
+
+template <typename T> using KernelFn = void (*)(const T *, const T *, const T *, T *, size_t);
+
+// 返回运算 O 在元素类型 T 和指令集 isa 上的内核。
+// 如果 T 没有 SIMD 特化，或者 CPU 不支持 isa，返回标量内核。
+template <Op O, typename T> KernelFn<T> kernel_for(Isa isa) {
+#if BOOTCAMP_SIMD_X86
+  if constexpr (has_simd<T>) {
+    if (cpu_supports(isa)) {
+      switch (isa) {
+      case Isa::SSE2:
+        return &sse2_kernel<O, T, VecTraits<T, Isa::SSE2>>;
+      case Isa::AVX2:
+        return &avx2_kernel<O, T, VecTraits<T, Isa::AVX2>>;
+      case Isa::AVX512:
+        return &avx512_kernel<O, T, VecTraits<T, Isa::AVX512>>;
+      default:
+        break;
+      }
+    }
+  }
+#endif
+  (void)isa;
+  return &scalar_kernel<O, T>;
+}
+
+// 对每一种 (运算, 类型) 组合，只在第一次调用时选择一次内核，之后直接通过函数指针调用。
+template <Op O, typename T> void dispatch(const T *a, const T *b, const T *c, T *out, size_t n) {
+  static const KernelFn<T> kernel = kernel_for<O, T>(best_isa());
+  kernel(a, b, c, out, n);
+}
+
+inline void check_size(size_t input, size_t out) {
+  if (input != out) {
+    throw std::invalid_argument("simd: input and output spans must have the same size");
+  }
+}
+
+// 下面是对外的接口：out[i] = a[i] op b[i]（fma 为 out[i] = a[i] * b[i] + c[i]）。
+// out 可以和某个输入是同一块内存。
+// 对于 float 和 double，fma 总是融合乘加（和 std::fma 相同，只舍入一次），
+// 在所有指令集上得到逐位相同的结果，不会因为程序运行在不同的 CPU 上而不同。
+template <typename T> void add(Span<const T> a, Span<const T> b, Span<T> out) {
+  check_size(a.size, out.size);
+  check_size(b.size, out.size);
+  dispatch<Op::Add>(a.data, b.data, static_cast<const T *>(nullptr), out.data, out.size);
+}
+
+template <typename T> void sub(Span<const T> a, Span<const T> b, Span<T> out) {
+  check_size(a.size, out.size);
+  check_size(b.size, out.size);
+  dispatch<Op::Sub>(a.data, b.data, static_cast<const T *>(nullptr), out.data, out.size);
+}
+
+template <typename T> void mul(Span<const T> a, Span<const T> b, Span<T> out) {
+  check_size(a.size, out.size);
+  check_size(b.size, out.size);
+  dispatch<Op::Mul>(a.data, b.data, static_cast<const T *>(nullptr), out.data, out.size);
+}
+
+template <typename T> void fma(Span<const T> a, Span<const T> b, Span<const T> c, Span<T> out) {
+  check_size(a.size, out.size);
+  check_size(b.size, out.size);
+  check_size(c.size, out.size);
+  dispatch<Op::Fma>(a.data, b.data, c.data, out.data, out.size);
+}
+
+} // namespace simd
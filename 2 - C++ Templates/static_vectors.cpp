@@ -0,0 +1,269 @@
+// 在 templated_classes.cpp 中，Bar<150> 的模板参数是一个值而不是类型；
+// 在 templated_functions.cpp 中，add3<true> 根据一个 bool 模板参数做不同的事情。
+// 这个文件用非类型模板参数做一件更实际的事情：在类型中记录向量和矩阵的大小。
+
+// StaticVec<T, N> 和 StaticMat<T, R, C> 的元素直接存放在对象内部（通常在栈上），不需要堆分配。
+// 因为大小是编译时常量，点积、矩阵乘法、转置等运算可以在编译时被完全展开：
+// 我们用 std::index_sequence<0, 1, ..., N-1> 生成下标，再用折叠表达式
+// （fold expression，例如 (a[I] * b[I] + ...)）把 N 次运算直接展开成一条表达式，
+// 生成的代码中没有循环、没有计数器，也没有边界检查。
+// 所有运算都是 constexpr 的，可以在编译时求值（唯一的例外是 norm，因为 std::sqrt 不是 constexpr 的）。
+
+// 作为对照，std::vector 的大小只在运行时才知道，每次运算都要执行一个循环，
+// 而且数据在堆上，两个小向量之间还要多一次指针跳转。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::sqrt。
+#include <cmath>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::index_sequence、std::make_index_sequence。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+template <typename T, size_t N> struct StaticVec {
+  // 这是一个聚合类型（aggregate），可以直接写 StaticVec<float, 3> v = {1, 2, 3}。
+  T data[N];
+
+  constexpr T &operator[](size_t i) { return data[i]; }
+  constexpr const T &operator[](size_t i) const { return data[i]; }
+  static constexpr size_t size() { return N; }
+};
+
+// R 行 C 列的矩阵，按行存储。
+template <typename T, size_t R, size_t C> struct StaticMat {
+  T data[R * C];
+
+  constexpr T &operator()(size_t r, size_t c) { return data[r * C + c]; }
+  constexpr const T &operator()(size_t r, size_t c) const { return data[r * C + c]; }
+  static constexpr size_t rows() { return R; }
+  static constexpr size_t cols() { return C; }
+};
+
+// 下面的 *_impl 函数都接受一个 std::index_sequence<I...> 参数，只是为了推导出下标包 I...，
+// 然后用包展开或者折叠表达式把每个下标上的运算写出来。
+
+template <typename T, size_t N, size_t... I>
+constexpr T dot_impl(const StaticVec<T, N> &a, const StaticVec<T, N> &b, std::index_sequence<I...>) {
+  return ((a[I] * b[I]) + ... + T(0));
+}
+
+template <typename T, size_t N, size_t... I>
+constexpr StaticVec<T, N> add_impl(const StaticVec<T, N> &a, const StaticVec<T, N> &b,
+                                   std::index_sequence<I...>) {
+  return {{(a[I] + b[I])...}};
+}
+
+template <typename T, size_t N, size_t... I>
+constexpr StaticVec<T, N> scale_impl(const StaticVec<T, N> &a, T s, std::index_sequence<I...>) {
+  return {{(a[I] * s)...}};
+}
+
+template <typename T, size_t N> constexpr T dot(const StaticVec<T, N> &a, const StaticVec<T, N> &b) {
+  return dot_impl(a, b, std::make_index_sequence<N>{});
+}
+
+template <typename T, size_t N>
+constexpr StaticVec<T, N> operator+(const StaticVec<T, N> &a, const StaticVec<T, N> &b) {
+  return add_impl(a, b, std::make_index_sequence<N>{});
+}
+
+template <typename T, size_t N> constexpr StaticVec<T, N> operator*(const StaticVec<T, N> &a, T s) {
+  return scale_impl(a, s, std::make_index_sequence<N>{});
+}
+
+template <typename T, size_t N> constexpr T squared_norm(const StaticVec<T, N> &a) {
+  return dot(a, a);
+}
+
+template <typename T, size_t N> T norm(const StaticVec<T, N> &a) {
+  return std::sqrt(squared_norm(a));
+}
+
+// 矩阵乘法按行展开：结果的第 Row 行等于 B 的各行的线性组合，
+// 即 sum over k of A(Row, k) * B 的第 k 行。与逐个元素求点积相比，
+// 这种写法让同一行的 C 个元素可以一起计算，编译器能把它们放进 SIMD 寄存器中。
+template <typename T, size_t R, size_t C, size_t... I>
+constexpr StaticVec<T, C> row_of(const StaticMat<T, R, C> &m, size_t r, std::index_sequence<I...>) {
+  return {{m(r, I)...}};
+}
+
+template <size_t Row, typename T, size_t R, size_t K, size_t C, size_t... I>
+constexpr StaticVec<T, C> matmul_row(const StaticMat<T, R, K> &a, const StaticMat<T, K, C> &b,
+                                     std::index_sequence<I...>) {
+  return ((row_of(b, I, std::make_index_sequence<C>{}) * a(Row, I)) + ...);
+}
+
+template <typename T, size_t R, size_t C, size_t... J>
+constexpr StaticMat<T, R, C> from_rows(const StaticVec<T, C> (&rows)[R], std::index_sequence<J...>) {
+  return {{rows[J / C][J % C]...}};
+}
+
+template <typename T, size_t R, size_t K, size_t C, size_t... Rows>
+constexpr StaticMat<T, R, C> matmul_impl(const StaticMat<T, R, K> &a, const StaticMat<T, K, C> &b,
+                                         std::index_sequence<Rows...>) {
+  const StaticVec<T, C> rows[R] = {matmul_row<Rows>(a, b, std::make_index_sequence<K>{})...};
+  return from_rows(rows, std::make_index_sequence<R * C>{});
+}
+
+// 维度不匹配的乘法（例如 2x3 乘 2x3）在编译时就会因为找不到匹配的模板而报错。
+template <typename T, size_t R, size_t K, size_t C>
+constexpr StaticMat<T, R, C> operator*(const StaticMat<T, R, K> &a, const StaticMat<T, K, C> &b) {
+  return matmul_impl(a, b, std::make_index_sequence<R>{});
+}
+
+// 矩阵乘以列向量：结果的第 r 个元素是 A 的第 r 行和 v 的点积。
+template <size_t Row, typename T, size_t R, size_t C, size_t... I>
+constexpr T row_dot(const StaticMat<T, R, C> &a, const StaticVec<T, C> &v, std::index_sequence<I...>) {
+  return ((a(Row, I) * v[I]) + ... + T(0));
+}
+
+template <typename T, size_t R, size_t C, size_t... Rows>
+constexpr StaticVec<T, R> matvec_impl(const StaticMat<T, R, C> &a, const StaticVec<T, C> &v,
+                                      std::index_sequence<Rows...>) {
+  return {{row_dot<Rows>(a, v, std::make_index_sequence<C>{})...}};
+}
+
+template <typename T, size_t R, size_t C>
+constexpr StaticVec<T, R> operator*(const StaticMat<T, R, C> &a, const StaticVec<T, C> &v) {
+  return matvec_impl(a, v, std::make_index_sequence<R>{});
+}
+
+// 转置：结果是 C 行 R 列的矩阵，它的第 J 个元素来自 A 的第 J % R 行、第 J / R 列。
+template <typename T, size_t R, size_t C, size_t... J>
+constexpr StaticMat<T, C, R> transpose_impl(const StaticMat<T, R, C> &a, std::index_sequence<J...>) {
+  return {{a(J % R, J / R)...}};
+}
+
+template <typename T, size_t R, size_t C>
+constexpr StaticMat<T, C, R> transpose(const StaticMat<T, R, C> &a) {
+  return transpose_impl(a, std::make_index_sequence<R * C>{});
+}
+
+// 所有的运算都可以在编译时求值。
+constexpr StaticVec<int, 3> kX = {{1, 2, 3}};
+constexpr StaticVec<int, 3> kY = {{4, 5, 6}};
+static_assert(dot(kX, kY) == 32, "compile-time dot product");
+static_assert((kX + kY)[2] == 9, "compile-time addition");
+constexpr StaticMat<int, 2, 3> kA = {{1, 2, 3, 4, 5, 6}};
+static_assert((kA * transpose(kA))(0, 1) == 32, "compile-time matmul and transpose");
+static_assert((kA * kX)[1] == 32, "compile-time matrix-vector product");
+
+// 对照组：大小在运行时才知道的 std::vector 版本，使用普通的循环。
+float vector_dot(const std::vector<float> &a, const std::vector<float> &b) {
+  float sum = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void vector_matmul(const std::vector<float> &a, const std::vector<float> &b, std::vector<float> &c,
+                   size_t n) {
+  for (size_t r = 0; r < n; ++r) {
+    for (size_t col = 0; col < n; ++col) {
+      float sum = 0;
+      for (size_t k = 0; k < n; ++k) {
+        sum += a[r * n + k] * b[k * n + col];
+      }
+      c[r * n + col] = sum;
+    }
+  }
+}
+
+// 对大小 N 比较两种实现：对 count 对向量求点积，以及 count 对 N x N 矩阵相乘。
+template <size_t N> void benchmark(double &checksum) {
+  const size_t count = 4096;
+  const int rounds = 256;
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<StaticVec<float, N>> sv(count);
+  std::vector<StaticMat<float, N, N>> sm(count);
+  std::vector<std::vector<float>> dv(count, std::vector<float>(N));
+  std::vector<std::vector<float>> dm(count, std::vector<float>(N * N));
+  // 矩阵乘法的结果写入预先分配好的输出中，两种实现都不在计时循环中分配内存。
+  std::vector<StaticMat<float, N, N>> sm_out(count);
+  std::vector<std::vector<float>> dm_out(count, std::vector<float>(N * N));
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      sv[i][j] = dv[i][j] = static_cast<float>((i + j) % 7) * 0.25f;
+    }
+    for (size_t j = 0; j < N * N; ++j) {
+      sm[i].data[j] = dm[i][j] = static_cast<float>((i * 3 + j) % 5) * 0.125f;
+    }
+  }
+
+  auto time = [&](auto body) {
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      body();
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / (rounds * (count - 1));
+  };
+
+  double static_dot = time([&] {
+    for (size_t i = 0; i + 1 < count; ++i) {
+      checksum += dot(sv[i], sv[i + 1]);
+    }
+  });
+  double vector_dot_ns = time([&] {
+    for (size_t i = 0; i + 1 < count; ++i) {
+      checksum += vector_dot(dv[i], dv[i + 1]);
+    }
+  });
+  double static_mm = time([&] {
+    for (size_t i = 0; i + 1 < count; ++i) {
+      sm_out[i] = sm[i] * sm[i + 1];
+    }
+    checksum += sm_out[count / 2](N - 1, 0);
+  });
+  double vector_mm = time([&] {
+    for (size_t i = 0; i + 1 < count; ++i) {
+      vector_matmul(dm[i], dm[i + 1], dm_out[i], N);
+    }
+    checksum += dm_out[count / 2][(N - 1) * N];
+  });
+
+  std::cout << "N = " << N << ": dot " << static_dot << " ns vs " << vector_dot_ns
+            << " ns, matmul " << static_mm << " ns vs " << vector_mm << " ns\n";
+}
+
+int main() {
+  // 首先，我们像使用 Bar<150> 一样，用模板参数指定大小来构造对象。
+  StaticVec<float, 3> v = {{3.0f, 4.0f, 0.0f}};
+  std::cout << "norm of (3, 4, 0): " << norm(v) << std::endl;
+  std::cout << "v + v scaled by 0.5: ";
+  auto w = (v + v) * 0.5f;
+  for (size_t i = 0; i < w.size(); ++i) {
+    std::cout << w[i] << " ";
+  }
+  std::cout << std::endl;
+
+  // 2x3 矩阵乘以它的转置得到一个 2x2 矩阵。结果的大小也是类型的一部分。
+  StaticMat<float, 2, 3> a = {{1, 2, 3, 4, 5, 6}};
+  StaticMat<float, 2, 2> aat = a * transpose(a);
+  std::cout << "A * A^T = [" << aat(0, 0) << ", " << aat(0, 1) << "; " << aat(1, 0) << ", "
+            << aat(1, 1) << "]" << std::endl;
+
+  // 编译时计算的结果可以用作数组大小这样的常量。
+  int buffer[dot(kX, kY)];
+  std::cout << "sizeof(int[dot(kX, kY)]) = " << sizeof(buffer) << std::endl;
+
+  // 基准测试：对每个大小 N，比较 StaticVec/StaticMat 与 std::vector 每次运算的平均耗时。
+  // 完全展开在 N 很小（2 ~ 4）时优势最明显：循环和堆上数据的开销占了运算的大部分。
+  // 当 N 达到 16 时，一次矩阵乘法被展开成 4096 次乘加，代码体积很大，
+  // 而编译器在 -O3 下对普通循环的自动向量化可能反而更快。所以这种技巧适合小的、固定大小的数学对象，
+  // 例如图形学中的 3x3、4x4 矩阵。
+  double checksum = 0;
+  benchmark<2>(checksum);
+  benchmark<3>(checksum);
+  benchmark<4>(checksum);
+  benchmark<8>(checksum);
+  benchmark<16>(checksum);
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
@@ -0,0 +1,248 @@
+// 在 unordered_maps.cpp 中，我们用 map.count("eggs") == 0 和 map.count("garlic rice") == 0
+// 检查某个键是否不在 map 中。如果大多数查找都是这样的"未命中"，
+// 每次未命中仍然要对键求哈希、访问一个很大的（往往不在缓存中的）桶数组，
+// 而结果只是告诉我们"没有"。
+
+// 布隆过滤器（Bloom filter）是一种近似的集合成员测试结构。它用一个位数组和 k 个哈希函数：
+//   - 插入一个键时，把 k 个哈希位置的位都设为 1；
+//   - 查询一个键时，如果 k 个位置中有任何一位是 0，这个键一定不在集合中；
+//     如果全是 1，这个键"可能"在集合中（有一定的假阳性概率，false positive）。
+// 它永远不会有假阴性，所以可以放在 map 前面：过滤器说"不在"时，直接返回未命中，不用访问 map。
+
+// 这里实现的是"分块布隆过滤器"（blocked Bloom filter）：
+// 位数组被分成 512 位（一个 64 字节的缓存行）大小的块，一个键的 k 个位全部落在同一块中。
+// 这样每次查询最多只访问一个缓存行，代价是在相同空间下假阳性率略高一些。
+
+// 布隆过滤器不支持删除（不能把位清零，因为其他键可能也用到了这一位），
+// 所以从 map 中删除键之后，过滤器会慢慢"变旧"，假阳性率升高。
+// FilteredMap 会统计假阳性的次数，调用者可以在需要时调用 rebuild_filter() 重建过滤器。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::log、std::lround。
+#include <cmath>
+// 包含 uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::hash。
+#include <functional>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 unordered_map 容器库头文件。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+class BlockedBloomFilter {
+  // 每块 512 位，用 8 个 uint64_t 表示，并按缓存行对齐。
+  struct alignas(64) Block {
+    uint64_t words[8];
+  };
+
+public:
+  // 根据预计的键数量和目标假阳性率计算位数组的大小和哈希函数个数：
+  // 每个键需要 -ln(p) / (ln 2)^2 位，最优的哈希函数个数是 (位数/键数) * ln 2。
+  // p 必须在 (0, 1) 之间：p <= 0 时位数是无穷大，p >= 1 时每个键 0 位，过滤器没有意义。
+  BlockedBloomFilter(size_t expected_keys, double false_positive_rate) {
+    // 写成 !(p > 0 && p < 1)，这样 NaN 也会被拒绝。
+    if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+      throw std::invalid_argument("false_positive_rate must be in (0, 1)");
+    }
+    double bits_per_key = -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0));
+    size_t bits = static_cast<size_t>(bits_per_key * static_cast<double>(expected_keys)) + 1;
+    blocks_.assign((bits + 511) / 512, Block{});
+    long k = std::lround(bits_per_key * std::log(2.0));
+    k_ = static_cast<int>(k < 1 ? 1 : (k > 16 ? 16 : k));
+  }
+
+  // 过滤器操作的是键的哈希值，而不是键本身，所以同一个过滤器可以用于任何类型的键。
+  void insert(uint64_t hash) {
+    Block &block = block_for(hash);
+    uint64_t h2 = second_hash(hash);
+    for (int i = 0; i < k_; ++i) {
+      uint64_t bit = (hash + i * h2) & 511;
+      block.words[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+  }
+
+  bool may_contain(uint64_t hash) const {
+    const Block &block = block_for(hash);
+    uint64_t h2 = second_hash(hash);
+    for (int i = 0; i < k_; ++i) {
+      uint64_t bit = (hash + i * h2) & 511;
+      if ((block.words[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void clear() { blocks_.assign(blocks_.size(), Block{}); }
+
+  size_t size_in_bytes() const { return blocks_.size() * sizeof(Block); }
+  int hash_count() const { return k_; }
+
+private:
+  // 用哈希值的高 32 位把键映射到某一块上（乘法代替取模）。
+  Block &block_for(uint64_t hash) {
+    return blocks_[((hash >> 32) * blocks_.size()) >> 32];
+  }
+  const Block &block_for(uint64_t hash) const {
+    return blocks_[((hash >> 32) * blocks_.size()) >> 32];
+  }
+
+  // 由第一个哈希值派生出第二个哈希值（双重哈希），用来生成块内的 k 个位置。
+  static uint64_t second_hash(uint64_t hash) {
+    uint64_t x = hash * 0x9E3779B97F4A7C15ULL;
+    return (x ^ (x >> 29)) | 1;
+  }
+
+  std::vector<Block> blocks_;
+  int k_;
+};
+
+// FilteredMap 是一个前面挂了布隆过滤器的 std::unordered_map。
+// 它统计三种查找结果：
+//   - hits：键存在；
+//   - filtered_misses：过滤器直接判定键不存在，没有访问 map；
+//   - false_positives：过滤器说"可能存在"，但 map 中没有这个键。
+template <typename K, typename V, typename Hash = std::hash<K>> class FilteredMap {
+public:
+  struct Stats {
+    size_t hits = 0;
+    size_t filtered_misses = 0;
+    size_t false_positives = 0;
+  };
+
+  FilteredMap(size_t expected_keys, double false_positive_rate)
+      : filter_(expected_keys, false_positive_rate) {}
+
+  bool insert(const K &key, V value) {
+    filter_.insert(hash_of(key));
+    return map_.emplace(key, std::move(value)).second;
+  }
+
+  // 只从 map 中删除，过滤器中的位保持不变（见文件开头的说明）。
+  size_t erase(const K &key) { return map_.erase(key); }
+
+  const V *find(const K &key) const {
+    if (!filter_.may_contain(hash_of(key))) {
+      ++stats_.filtered_misses;
+      return nullptr;
+    }
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+      ++stats_.false_positives;
+      return nullptr;
+    }
+    ++stats_.hits;
+    return &it->second;
+  }
+
+  size_t count(const K &key) const { return find(key) != nullptr ? 1 : 0; }
+
+  // 用 map 中当前的键重建过滤器，清除删除操作留下的陈旧位。
+  void rebuild_filter() {
+    filter_.clear();
+    for (const auto &elem : map_) {
+      filter_.insert(hash_of(elem.first));
+    }
+  }
+
+  const Stats &stats() const { return stats_; }
+  void reset_stats() { stats_ = Stats(); }
+  const BlockedBloomFilter &filter() const { return filter_; }
+  size_t size() const { return map_.size(); }
+
+private:
+  // std::hash 对整数通常是恒等函数，再做一次混合，让高位和低位都分布均匀。
+  static uint64_t hash_of(const K &key) {
+    uint64_t h = static_cast<uint64_t>(Hash{}(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  std::unordered_map<K, V, Hash> map_;
+  BlockedBloomFilter filter_;
+  // find 是 const 函数，但仍然需要更新统计信息。
+  mutable Stats stats_;
+};
+
+int main() {
+  // 首先，我们重复 unordered_maps.cpp 中的未命中检查。
+  FilteredMap<std::string, int> map(100, 0.01);
+  map.insert("foo", 2);
+  map.insert("jignesh", 445);
+  map.insert("spam", 15);
+  map.insert("eggs", 2);
+  map.insert("garlic rice", 3);
+  map.erase("eggs");
+  map.erase("garlic rice");
+  if (map.count("eggs") == 0 && map.count("garlic rice") == 0) {
+    std::cout << "Keys eggs and garlic rice do not exist in the map.\n";
+  }
+  if (map.count("bacon") == 0) {
+    std::cout << "Key bacon does not exist in the map.\n";
+  }
+  const auto &stats = map.stats();
+  std::cout << "hits " << stats.hits << ", filtered misses " << stats.filtered_misses
+            << ", false positives " << stats.false_positives << "\n";
+  // eggs 和 garlic rice 被删除后仍在过滤器中，所以它们是假阳性。重建之后就会被过滤掉。
+  map.rebuild_filter();
+  map.reset_stats();
+  map.count("eggs");
+  std::cout << "After rebuild: filtered misses " << map.stats().filtered_misses << "\n";
+
+  // 基准测试：一个有 n 个键的大 map，查找中 95% 是未命中。
+  // 分别测量不带过滤器的 std::unordered_map，和不同假阳性率的 FilteredMap。
+  const size_t n = 2000000;
+  const size_t lookups = 10000000;
+  std::vector<uint64_t> probes;
+  uint64_t state = 42;
+  for (size_t i = 0; i < lookups; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // 5% 的探测落在已插入的偶数键上，其余的都是奇数键（一定不存在）。
+    uint64_t r = (state >> 33) % n;
+    probes.push_back((state >> 20) % 100 < 5 ? r * 2 : r * 2 + 1);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  long long sum = 0;
+  {
+    std::unordered_map<uint64_t, int> plain;
+    for (size_t i = 0; i < n; ++i) {
+      plain.emplace(i * 2, 1);
+    }
+    auto start = Clock::now();
+    for (uint64_t key : probes) {
+      sum += static_cast<long long>(plain.count(key));
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    std::cout << "std::unordered_map:        " << elapsed.count() / lookups << " ns/lookup\n";
+  }
+  for (double rate : {0.05, 0.01, 0.001}) {
+    FilteredMap<uint64_t, int> filtered(n, rate);
+    for (size_t i = 0; i < n; ++i) {
+      filtered.insert(i * 2, 1);
+    }
+    auto start = Clock::now();
+    for (uint64_t key : probes) {
+      sum += static_cast<long long>(filtered.count(key));
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    const auto &s = filtered.stats();
+    std::cout << "FilteredMap (target " << rate << "): " << elapsed.count() / lookups
+              << " ns/lookup, filter " << filtered.filter().size_in_bytes() / 1024 << " KiB, k "
+              << filtered.filter().hash_count() << ", hits " << s.hits << ", filtered misses "
+              << s.filtered_misses << ", false positives " << s.false_positives << " ("
+              << 100.0 * s.false_positives / (s.false_positives + s.filtered_misses) << "%)\n";
+  }
+  std::cout << "Checksum: " << sum << "\n";
+
+  return 0;
+}
@@ -0,0 +1,262 @@
+// templated_classes.cpp 中的 Foo2<T, U> 和 auto.cpp 中的 Abcdefghijklmnopqrstuvwxyz<T, U>
+// 都是由两个字段组成的"记录"。把几百万条这样的记录放在 std::vector 中时，它们按行存储
+// （array of structs，AoS）：每条记录的两个字段在内存中相邻。
+// 如果我们只想对第一个字段求和，CPU 仍然要把整条记录所在的缓存行读进来，
+// 另一个字段也一起占用了内存带宽和缓存空间。
+
+// 这个文件实现一个通用的列式容器 ColumnStore<Ts...>（struct of arrays，SoA）：
+// 每个字段存放在自己的连续数组（列）中。它提供：
+//   - 按行访问：store.row(i) 或者 for (auto row : store) 返回一个"行代理"（row proxy），
+//     它只记住容器和行号，row.get<I>() 返回第 I 列中这一行的引用；
+//   - 按列扫描：scan、filter、aggregate 只访问需要的那一列，数据是连续的，
+//     缓存和硬件预取都能被充分利用，编译器也更容易把循环向量化。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 int32_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::tuple、std::get、std::apply。
+#include <tuple>
+// 包含 std::conditional_t。
+#include <type_traits>
+// 包含 std::index_sequence。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 与 auto.cpp 中相同的记录类型。
+template <typename T, typename U> class Abcdefghijklmnopqrstuvwxyz {
+public:
+  Abcdefghijklmnopqrstuvwxyz(T instance1, U instance2)
+      : instance1_(instance1), instance2_(instance2) {}
+
+  void print() const { std::cout << "(" << instance1_ << "," << instance2_ << ")\n"; }
+
+private:
+  T instance1_;
+  U instance2_;
+};
+
+// 与 templated_classes.cpp 中相同的记录类型，增加了读取成员的函数，用作基准测试的对照组。
+template <typename T, typename U> class Foo2 {
+public:
+  Foo2(T var1, U var2) : var1_(var1), var2_(var2) {}
+  const T &var1() const { return var1_; }
+  const U &var2() const { return var2_; }
+
+private:
+  T var1_;
+  U var2_;
+};
+
+template <typename... Ts> class ColumnStore {
+public:
+  // 第 I 列的元素类型。
+  template <size_t I> using column_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+  // 行代理。IsConst 为 true 时只能读取。代理很小（一个指针和一个下标），按值传递。
+  template <bool IsConst> class Row {
+    using Store = std::conditional_t<IsConst, const ColumnStore, ColumnStore>;
+
+  public:
+    Row(Store *store, size_t index) : store_(store), index_(index) {}
+
+    template <size_t I> decltype(auto) get() const { return std::get<I>(store_->columns_)[index_]; }
+
+    // 用这一行的所有字段构造一个记录对象，例如 Abcdefghijklmnopqrstuvwxyz<int, double>。
+    template <typename Record> Record as() const {
+      return as_impl<Record>(std::index_sequence_for<Ts...>{});
+    }
+
+    size_t index() const { return index_; }
+
+  private:
+    template <typename Record, size_t... I> Record as_impl(std::index_sequence<I...>) const {
+      return Record(get<I>()...);
+    }
+
+    Store *store_;
+    size_t index_;
+  };
+
+  // 行迭代器：解引用时返回一个行代理，而不是引用（因为并不存在一个完整的"行对象"）。
+  template <bool IsConst> class RowIterator {
+    using Store = std::conditional_t<IsConst, const ColumnStore, ColumnStore>;
+
+  public:
+    RowIterator(Store *store, size_t index) : store_(store), index_(index) {}
+    Row<IsConst> operator*() const { return Row<IsConst>(store_, index_); }
+    RowIterator &operator++() {
+      ++index_;
+      return *this;
+    }
+    bool operator!=(const RowIterator &other) const { return index_ != other.index_; }
+
+  private:
+    Store *store_;
+    size_t index_;
+  };
+
+  void push_back(const Ts &...values) { push_back_impl(std::index_sequence_for<Ts...>{}, values...); }
+
+  void reserve(size_t n) {
+    std::apply([n](auto &...columns) { (columns.reserve(n), ...); }, columns_);
+  }
+
+  size_t size() const { return std::get<0>(columns_).size(); }
+
+  Row<false> row(size_t i) { return Row<false>(this, i); }
+  Row<true> row(size_t i) const { return Row<true>(this, i); }
+
+  RowIterator<false> begin() { return RowIterator<false>(this, 0); }
+  RowIterator<false> end() { return RowIterator<false>(this, size()); }
+  RowIterator<true> begin() const { return RowIterator<true>(this, 0); }
+  RowIterator<true> end() const { return RowIterator<true>(this, size()); }
+
+  // 直接访问第 I 列。
+  template <size_t I> const std::vector<column_type<I>> &column() const {
+    return std::get<I>(columns_);
+  }
+
+  // 对第 I 列的每个值调用 fn(value)。
+  template <size_t I, typename Fn> void scan(Fn fn) const {
+    for (const auto &value : std::get<I>(columns_)) {
+      fn(value);
+    }
+  }
+
+  // 返回第 I 列满足 pred 的所有行号（"选择向量"），可以再用于其他列。
+  template <size_t I, typename Pred> std::vector<size_t> filter(Pred pred) const {
+    std::vector<size_t> rows;
+    const auto &column = std::get<I>(columns_);
+    for (size_t i = 0; i < column.size(); ++i) {
+      if (pred(column[i])) {
+        rows.push_back(i);
+      }
+    }
+    return rows;
+  }
+
+  // 用 op(acc, value) 把第 I 列折叠成一个值。
+  template <size_t I, typename Acc, typename Op> Acc aggregate(Acc init, Op op) const {
+    for (const auto &value : std::get<I>(columns_)) {
+      init = op(init, value);
+    }
+    return init;
+  }
+
+  // 只对 rows 中列出的行折叠第 I 列，通常和 filter 一起使用。
+  template <size_t I, typename Acc, typename Op>
+  Acc aggregate(const std::vector<size_t> &rows, Acc init, Op op) const {
+    const auto &column = std::get<I>(columns_);
+    for (size_t i : rows) {
+      init = op(init, column[i]);
+    }
+    return init;
+  }
+
+private:
+  template <size_t... I> void push_back_impl(std::index_sequence<I...>, const Ts &...values) {
+    (std::get<I>(columns_).push_back(values), ...);
+  }
+
+  std::tuple<std::vector<Ts>...> columns_;
+};
+
+int main() {
+  // 首先，我们把 auto.cpp 中那样的记录按列存储，再按行读出来。
+  ColumnStore<int, double> store;
+  store.push_back(2, 0.5);
+  store.push_back(445, 3.25);
+  store.push_back(645, 1.75);
+  std::cout << "Printing rows as Abcdefghijklmnopqrstuvwxyz<int, double>...\n";
+  for (auto row : store) {
+    row.as<Abcdefghijklmnopqrstuvwxyz<int, double>>().print();
+  }
+
+  // 行代理返回的是列中元素的引用，可以直接修改。
+  store.row(0).get<1>() = 10.0;
+  std::cout << "Row 0 after update: " << store.row(0).get<0>() << ", " << store.row(0).get<1>()
+            << "\n";
+
+  // 按列查询：第一列大于 100 的行中，第二列的和。只访问这两列中需要的部分。
+  auto rows = store.filter<0>([](int v) { return v > 100; });
+  double total = store.aggregate<1>(rows, 0.0, [](double acc, double v) { return acc + v; });
+  std::cout << "Sum of column 1 where column 0 > 100: " << total << "\n";
+
+  // 基准测试：n 条 (int32_t, double) 记录，分别存放在 std::vector<Foo2<int32_t, double>>（行式）
+  // 和 ColumnStore<int32_t, double>（列式）中。每条记录有 16 个字节，而第一个字段只占 4 个字节。
+  const size_t n = 20000000;
+  std::vector<Foo2<int32_t, double>> rows_store;
+  ColumnStore<int32_t, double> columns;
+  rows_store.reserve(n);
+  columns.reserve(n);
+  uint64_t state = 7;
+  for (size_t i = 0; i < n; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    int32_t key = static_cast<int32_t>((state >> 33) % 1000);
+    double value = static_cast<double>(i % 100) * 0.5;
+    rows_store.emplace_back(key, value);
+    columns.push_back(key, value);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  auto time_ms = [](auto body) {
+    auto start = Clock::now();
+    body();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    return elapsed.count();
+  };
+  double checksum = 0;
+
+  // 1. 对第一列求和。
+  double aos = time_ms([&] {
+    long long sum = 0;
+    for (const auto &r : rows_store) {
+      sum += r.var1();
+    }
+    checksum += static_cast<double>(sum);
+  });
+  double soa = time_ms([&] {
+    checksum += static_cast<double>(
+        columns.aggregate<0>(0LL, [](long long acc, int32_t v) { return acc + v; }));
+  });
+  std::cout << n << " rows:\n  sum(key):                  AoS " << aos << " ms, columns " << soa
+            << " ms\n";
+
+  // 2. 统计第一列中满足条件的行数。
+  aos = time_ms([&] {
+    size_t count = 0;
+    for (const auto &r : rows_store) {
+      count += r.var1() < 10;
+    }
+    checksum += static_cast<double>(count);
+  });
+  soa = time_ms([&] {
+    size_t count = 0;
+    columns.scan<0>([&](int32_t v) { count += v < 10; });
+    checksum += static_cast<double>(count);
+  });
+  std::cout << "  count(key < 10):           AoS " << aos << " ms, columns " << soa << " ms\n";
+
+  // 3. 先按第一列过滤（约 1% 的行），再对这些行的第二列求和。
+  aos = time_ms([&] {
+    double sum = 0;
+    for (const auto &r : rows_store) {
+      if (r.var1() < 10) {
+        sum += r.var2();
+      }
+    }
+    checksum += sum;
+  });
+  soa = time_ms([&] {
+    auto selected = columns.filter<0>([](int32_t v) { return v < 10; });
+    checksum += columns.aggregate<1>(selected, 0.0, [](double acc, double v) { return acc + v; });
+  });
+  std::cout << "  sum(value) where key < 10: AoS " << aos << " ms, columns " << soa << " ms\n";
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
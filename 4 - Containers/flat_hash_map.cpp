@@ -0,0 +1,115 @@
+// 在这个文件中，我们把 flat_hash_map.h 中实现的开放寻址（open addressing）"扁平"哈希表 FlatHashMap
+// 和 unordered_maps.cpp 中介绍的 std::unordered_map 进行比较。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::stoi 等字符串工具。
+#include <string>
+// 包含 unordered_map 容器库头文件，作为基准测试的对照组。
+#include <unordered_map>
+// 包含 std::make_pair。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含 FlatHashMap 的实现。
+#include "flat_hash_map.h"
+
+// 对 fn 计时，返回每次操作的平均纳秒数。
+template <typename Fn> double ns_per_op(size_t ops, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(ops);
+}
+
+// 对一种 map 类型运行插入、命中查找、未命中查找和遍历四项基准测试。
+template <typename Map> void bench(const char *name, const std::vector<std::string> &keys,
+                                   const std::vector<std::string> &missing) {
+  Map map;
+  double insert_ns = ns_per_op(keys.size(), [&]() {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      map.insert({keys[i], static_cast<int>(i)});
+    }
+  });
+  long long sum = 0;
+  double hit_ns = ns_per_op(keys.size(), [&]() {
+    for (const auto &key : keys) {
+      sum += map.find(key)->second;
+    }
+  });
+  double miss_ns = ns_per_op(missing.size(), [&]() {
+    for (const auto &key : missing) {
+      sum += static_cast<long long>(map.count(key));
+    }
+  });
+  double iterate_ns = ns_per_op(keys.size(), [&]() {
+    for (const auto &elem : map) {
+      sum += elem.second;
+    }
+  });
+  std::cout << "  " << name << ": insert " << insert_ns << " ns, hit " << hit_ns
+            << " ns, miss " << miss_ns << " ns, iterate " << iterate_ns
+            << " ns (checksum " << sum << ")\n";
+}
+
+int main(int argc, char **argv) {
+  // 首先，我们重复 unordered_maps.cpp 中的操作，展示 FlatHashMap 的接口与 std::unordered_map 相同。
+  FlatHashMap<std::string, int> map;
+  map.insert({"foo", 2});
+  map.insert(std::make_pair("jignesh", 445));
+  map.insert({"spam", 1});
+  map.insert({"eggs", 2});
+  map.insert({"garlic rice", 3});
+  map["bacon"] = 5;
+  map["spam"] = 15;
+
+  auto result = map.find("jignesh");
+  if (result != map.end()) {
+    std::cout << "Found key " << result->first << " with value " << result->second
+              << std::endl;
+  }
+  if (map.count("spam") == 1) {
+    std::cout << "A key-value pair with key spam exists in the flat hash map.\n";
+  }
+  map.erase("eggs");
+  if (map.count("eggs") == 0) {
+    std::cout << "Key-value pair with key eggs does not exist in the flat hash map.\n";
+  }
+  map.erase(map.find("garlic rice"));
+  if (map.count("garlic rice") == 0) {
+    std::cout << "Key-value pair with key garlic rice does not exist in the flat hash map.\n";
+  }
+  std::cout << "Printing the elements with a for-each loop:\n";
+  for (const auto &elem : map) {
+    std::cout << "(" << elem.first << ", " << elem.second << "), ";
+  }
+  std::cout << "\n";
+
+  // 接下来是基准测试：键的数量从 1K 增长到 max_keys。
+  // 默认最多 1M 个键，可以通过第一个命令行参数修改，例如 ./flat_hash_map 10000000。
+  size_t max_keys = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  // 短键（"key-N"）可以放进 std::string 的短字符串缓冲区，移动和拷贝都不需要分配内存；
+  // 长键（超过 30 个字符）放不下，可以看出扩容时移动元素而不是拷贝键的效果。
+  for (size_t n = 1000; n <= max_keys; n *= 10) {
+    for (const char *prefix : {"key-", "customer-session-identifier-key-"}) {
+      std::vector<std::string> keys;
+      std::vector<std::string> missing;
+      keys.reserve(n);
+      missing.reserve(n);
+      for (size_t i = 0; i < n; ++i) {
+        keys.push_back(prefix + std::to_string(i * 2654435761ULL % (n * 16)));
+        missing.push_back(prefix + std::string("missing-") + std::to_string(i));
+      }
+      std::cout << n << " keys like " << keys.front() << ":\n";
+      bench<std::unordered_map<std::string, int>>("std::unordered_map", keys, missing);
+      bench<FlatHashMap<std::string, int>>("FlatHashMap       ", keys, missing);
+    }
+  }
+
+  return 0;
+}
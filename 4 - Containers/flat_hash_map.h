@@ -0,0 +1,325 @@
+// 这个头文件实现一个开放寻址（open addressing）的"扁平"哈希表 FlatHashMap。
+// 它被 flat_hash_map.cpp（和 std::unordered_map 的比较）和 string_interning.cpp（以符号为键的 map）使用。
+
+// std::unordered_map 通常实现为"桶数组 + 链表"：每插入一个元素，都要在堆上分配一个节点，
+// 每次查找都要先读桶数组，再跟随一个指针跳到节点上。
+// 节点散落在堆的各处，所以查找常常会引起缓存未命中。
+
+// 扁平哈希表把所有元素直接存放在一个连续的数组（槽位数组）中，不需要为每个元素分配节点。
+// 除了槽位数组，我们还维护一个"控制字节"数组，每个槽位对应一个字节：
+//   - 0x80 表示这个槽位是空的；
+//   - 0x00 ~ 0x7F 表示槽位已被占用，数值是该元素哈希值的高 7 位（称为 H2）。
+// 查找时，我们用 SSE2 指令一次比较 16 个控制字节和目标的 H2，
+// 只有控制字节匹配的槽位才需要真正比较键。这个思路来自 Google 的 SwissTable（absl::flat_hash_map）。
+
+// 与 SwissTable 不同，这里使用按槽位的线性探测，并在删除时做"向后移位"（backward shift）：
+// 删除一个元素后，把它后面本该更靠前的元素往前挪，因此永远不需要"墓碑"（tombstone）标记。
+// 这保证了一个不变式：每个元素都位于它的起始槽位和之后的第一个空槽位之间，
+// 所以查找一旦在 16 字节的窗口中看到空槽位，就可以确定键不存在。
+
+#pragma once
+
+// 包含 uint8_t、uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::memset、std::memcpy。
+#include <cstring>
+// 包含 std::hash。
+#include <functional>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 placement new。
+#include <new>
+// 包含 std::conditional、std::enable_if。
+#include <type_traits>
+// 包含 std::pair、std::move。
+#include <utility>
+
+// 只有在编译器目标支持 SSE2 时（所有 x86-64 处理器都支持）才使用 SIMD 指令，
+// 否则（例如在 ARM 上）退回到逐字节比较的可移植实现。
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Group 表示 16 个连续的控制字节，提供"哪些字节等于某个值"的位掩码查询。
+// 返回的位掩码中，第 i 位为 1 表示第 i 个控制字节匹配。
+class Group {
+public:
+  static constexpr size_t kWidth = 16;
+
+  explicit Group(const uint8_t *ctrl) {
+#if defined(__SSE2__)
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+    std::memcpy(ctrl_, ctrl, kWidth);
+#endif
+  }
+
+  uint32_t match(uint8_t h2) const {
+#if defined(__SSE2__)
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(static_cast<char>(h2)))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; ++i) {
+      mask |= static_cast<uint32_t>(ctrl_[i] == h2) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // 空槽位的控制字节是 0x80，它是唯一一个最高位为 1 的值，
+  // 所以 movemask（收集每个字节的最高位）直接给出空槽位的掩码。
+  uint32_t match_empty() const {
+#if defined(__SSE2__)
+    return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+    return match(0x80);
+#endif
+  }
+
+private:
+#if defined(__SSE2__)
+  __m128i ctrl_;
+#else
+  uint8_t ctrl_[kWidth];
+#endif
+};
+
+// 返回掩码中最低的 1 所在的位置。
+inline int lowest_bit(uint32_t mask) { return __builtin_ctz(mask); }
+
+// FlatHashMap 的接口模仿 std::unordered_map：insert、operator[]、find、count、erase、
+// 以及可以用于 for-each 循环的迭代器。
+template <typename K, typename V, typename Hash = std::hash<K>> class FlatHashMap {
+public:
+  using value_type = std::pair<const K, V>;
+
+private:
+  static constexpr uint8_t kEmpty = 0x80;
+  static constexpr size_t kMinCapacity = Group::kWidth;
+
+  // 槽位是未初始化的内存，只有被占用时才在其中构造一个元素。
+  // 对外（通过迭代器）键是 const 的，但扩容和向后移位需要把元素从一个槽位移动到另一个槽位，
+  // 从 std::pair<const K, V> 移动时键只能被拷贝：对于超出短字符串缓冲区的 std::string 键，
+  // 每次移动都要分配内存。所以元素总是通过 mutable_value 构造、移动和析构，
+  // 只通过 value 交给使用者。两种 pair 的布局相同，absl::flat_hash_map 也用同样的做法。
+  union Slot {
+    Slot() {}
+    ~Slot() {}
+    value_type value;
+    std::pair<K, V> mutable_value;
+  };
+
+public:
+  // 迭代器跳过所有空槽位。IsConst 决定它是 iterator 还是 const_iterator。
+  template <bool IsConst> class Iterator {
+    using MapPtr = typename std::conditional<IsConst, const FlatHashMap *, FlatHashMap *>::type;
+    using Ref = typename std::conditional<IsConst, const value_type &, value_type &>::type;
+    using Ptr = typename std::conditional<IsConst, const value_type *, value_type *>::type;
+
+  public:
+    Iterator(MapPtr map, size_t index) : map_(map), index_(index) { skip_empty(); }
+    // 允许从 iterator 隐式转换为 const_iterator。
+    template <bool C = IsConst, typename = typename std::enable_if<C>::type>
+    Iterator(const Iterator<false> &other) : map_(other.map_), index_(other.index_) {}
+
+    Ref operator*() const { return map_->slots_[index_].value; }
+    Ptr operator->() const { return &map_->slots_[index_].value; }
+    Iterator &operator++() {
+      ++index_;
+      skip_empty();
+      return *this;
+    }
+    bool operator==(const Iterator &other) const { return index_ == other.index_; }
+    bool operator!=(const Iterator &other) const { return index_ != other.index_; }
+
+  private:
+    friend class FlatHashMap;
+    template <bool> friend class Iterator;
+
+    void skip_empty() {
+      while (index_ < map_->capacity_ && map_->ctrl_[index_] == kEmpty) {
+        ++index_;
+      }
+    }
+
+    MapPtr map_;
+    size_t index_;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatHashMap() { allocate(kMinCapacity); }
+
+  ~FlatHashMap() { destroy_all(); }
+
+  FlatHashMap(const FlatHashMap &) = delete;
+  FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, capacity_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // 插入一个键值对。如果键已经存在，不做修改，并返回指向已有元素的迭代器和 false。
+  // 参数的键不是 const 的，所以临时的 pair 中的键可以被移动到槽位中，而不是被拷贝。
+  std::pair<iterator, bool> insert(std::pair<K, V> value) {
+    size_t hash = hash_of(value.first);
+    size_t index = find_index(value.first, hash);
+    if (index != capacity_) {
+      return {iterator(this, index), false};
+    }
+    index = insert_new(hash, std::move(value));
+    return {iterator(this, index), true};
+  }
+
+  // 数组风格的访问：如果键不存在，就插入一个默认构造的值。
+  V &operator[](const K &key) {
+    size_t hash = hash_of(key);
+    size_t index = find_index(key, hash);
+    if (index == capacity_) {
+      index = insert_new(hash, std::pair<K, V>(key, V()));
+    }
+    return slots_[index].value.second;
+  }
+
+  iterator find(const K &key) { return iterator(this, find_index(key, hash_of(key))); }
+  const_iterator find(const K &key) const {
+    return const_iterator(this, find_index(key, hash_of(key)));
+  }
+
+  size_t count(const K &key) const { return find_index(key, hash_of(key)) != capacity_ ? 1 : 0; }
+
+  // 按键删除，返回删除的元素个数（0 或 1）。
+  size_t erase(const K &key) {
+    size_t index = find_index(key, hash_of(key));
+    if (index == capacity_) {
+      return 0;
+    }
+    erase_at(index);
+    return 1;
+  }
+
+  // 按迭代器删除。注意：由于向后移位，删除之后所有迭代器都会失效。
+  void erase(const_iterator it) { erase_at(it.index_); }
+
+private:
+  // std::hash 对整数通常是恒等函数，所以我们再做一次乘法混合，
+  // 让低位（决定起始槽位）和高位都分布均匀。
+  size_t hash_of(const K &key) const {
+    uint64_t h = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+  static uint8_t h2_of(size_t hash) { return static_cast<uint8_t>(hash >> 57) & 0x7F; }
+  size_t home_of(size_t hash) const { return hash & (capacity_ - 1); }
+
+  // 控制字节数组比槽位多出 16 个字节，是前 16 个控制字节的镜像。
+  // 这样从任何位置开始加载 16 个字节都不会越界，探测也能自然地绕回数组开头。
+  void set_ctrl(size_t index, uint8_t value) {
+    ctrl_[index] = value;
+    if (index < Group::kWidth) {
+      ctrl_[capacity_ + index] = value;
+    }
+  }
+
+  size_t find_index(const K &key, size_t hash) const {
+    uint8_t h2 = h2_of(hash);
+    size_t pos = home_of(hash);
+    while (true) {
+      Group group(&ctrl_[pos]);
+      for (uint32_t mask = group.match(h2); mask != 0; mask &= mask - 1) {
+        size_t index = (pos + lowest_bit(mask)) & (capacity_ - 1);
+        if (slots_[index].value.first == key) {
+          return index;
+        }
+      }
+      if (group.match_empty() != 0) {
+        return capacity_;
+      }
+      pos = (pos + Group::kWidth) & (capacity_ - 1);
+    }
+  }
+
+  // 在已知键不存在的前提下插入。负载因子超过 7/8 时先扩容。
+  size_t insert_new(size_t hash, std::pair<K, V> &&value) {
+    if ((size_ + 1) * 8 > capacity_ * 7) {
+      rehash(capacity_ * 2);
+    }
+    size_t pos = home_of(hash);
+    while (true) {
+      uint32_t mask = Group(&ctrl_[pos]).match_empty();
+      if (mask != 0) {
+        size_t index = (pos + lowest_bit(mask)) & (capacity_ - 1);
+        new (&slots_[index].mutable_value) std::pair<K, V>(std::move(value));
+        set_ctrl(index, h2_of(hash));
+        ++size_;
+        return index;
+      }
+      pos = (pos + Group::kWidth) & (capacity_ - 1);
+    }
+  }
+
+  // 向后移位删除：从被删除的槽位往后扫描，直到遇到空槽位。
+  // 如果某个元素的起始槽位不在 (hole, j] 这个循环区间内，
+  // 说明它可以（也必须）被移到空出来的位置上，否则查找它时会提前遇到空槽位。
+  void erase_at(size_t hole) {
+    size_t mask = capacity_ - 1;
+    destroy(hole);
+    size_t j = hole;
+    while (true) {
+      j = (j + 1) & mask;
+      if (ctrl_[j] == kEmpty) {
+        break;
+      }
+      size_t home = home_of(hash_of(slots_[j].value.first));
+      if (((j - home) & mask) >= ((j - hole) & mask)) {
+        new (&slots_[hole].mutable_value) std::pair<K, V>(std::move(slots_[j].mutable_value));
+        destroy(j);
+        set_ctrl(hole, ctrl_[j]);
+        hole = j;
+      }
+    }
+    set_ctrl(hole, kEmpty);
+    --size_;
+  }
+
+  void allocate(size_t capacity) {
+    capacity_ = capacity;
+    size_ = 0;
+    slots_.reset(new Slot[capacity]);
+    ctrl_.reset(new uint8_t[capacity + Group::kWidth]);
+    std::memset(ctrl_.get(), kEmpty, capacity + Group::kWidth);
+  }
+
+  void rehash(size_t new_capacity) {
+    std::unique_ptr<Slot[]> old_slots = std::move(slots_);
+    std::unique_ptr<uint8_t[]> old_ctrl = std::move(ctrl_);
+    size_t old_capacity = capacity_;
+    allocate(new_capacity);
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old_ctrl[i] != kEmpty) {
+        insert_new(hash_of(old_slots[i].value.first), std::move(old_slots[i].mutable_value));
+        old_slots[i].mutable_value.~pair();
+      }
+    }
+  }
+
+  void destroy(size_t index) { slots_[index].mutable_value.~pair(); }
+
+  void destroy_all() {
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (ctrl_[i] != kEmpty) {
+        destroy(i);
+      }
+    }
+  }
+
+  std::unique_ptr<Slot[]> slots_;
+  std::unique_ptr<uint8_t[]> ctrl_;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+};
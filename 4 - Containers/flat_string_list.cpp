@@ -0,0 +1,354 @@
+// move_constructors.cpp 中的 Person 用 std::vector<std::string> nicknames_ 保存昵称。
+// 这意味着每个 Person 至少有一块堆内存（vector 的元素数组），
+// 再加上每个放不进短字符串优化（SSO，libstdc++ 中最多 15 个字符）缓冲区的昵称各一块。
+// GetNicknameAtI(i) 要先通过 vector 的指针找到第 i 个 std::string，
+// 如果是长字符串，再通过 std::string 的指针找到字符，一共要跳两次指针。
+
+// 这个文件实现一个紧凑的字符串列表 FlatStringList：
+//   - 所有字符串的字节首尾相接地存放在一个连续的字节缓冲区中；
+//   - 另有一个偏移数组，记录每个字符串在字节缓冲区中的结束位置，
+//     第 i 个字符串占据 [ends[i - 1], ends[i]) 这一段（第 0 个字符串从 0 开始）。
+// 字节和偏移数组共用同一块堆内存，所以无论有多少个字符串，一共只有一次堆分配；
+// operator[] 返回一个 std::string_view，只需要读一次偏移就能直接找到字符。
+// 移动一个 FlatStringList 只是转移一个指针，代价是常数。
+// 代价是它只支持在末尾追加，不能单独修改或删除中间的某个字符串。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t 的头文件。
+#include <cstdint>
+// 包含 std::malloc、std::free。
+#include <cstdlib>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::initializer_list。
+#include <initializer_list>
+// 包含 std::bad_alloc。
+#include <new>
+// 包含 std::length_error。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 为了比较内存占用，我们替换全局的 operator new 和 operator delete，
+// 在每块内存前面记录它的大小，从而统计当前仍在使用的堆内存字节数和块数。
+// 注意：每个块在分配器内部还有额外的簿记开销，这里没有计入，所以块数越多，真实占用越大。
+static size_t live_bytes = 0;
+static size_t live_blocks = 0;
+
+void *operator new(size_t size) {
+  void *raw = std::malloc(size + 16);
+  if (raw == nullptr) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t *>(raw) = size;
+  live_bytes += size;
+  ++live_blocks;
+  return static_cast<char *>(raw) + 16;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  void *raw = static_cast<char *>(ptr) - 16;
+  live_bytes -= *static_cast<size_t *>(raw);
+  --live_blocks;
+  std::free(raw);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+class FlatStringList {
+public:
+  // 遍历时依次返回每个字符串的 std::string_view。
+  class const_iterator {
+  public:
+    const_iterator(const FlatStringList *list, size_t index) : list_(list), index_(index) {}
+    std::string_view operator*() const { return (*list_)[index_]; }
+    const_iterator &operator++() {
+      ++index_;
+      return *this;
+    }
+    bool operator!=(const const_iterator &other) const { return index_ != other.index_; }
+
+  private:
+    const FlatStringList *list_;
+    size_t index_;
+  };
+
+  FlatStringList() = default;
+  FlatStringList(std::initializer_list<std::string_view> strings) {
+    size_t bytes = 0;
+    for (std::string_view s : strings) {
+      bytes += s.size();
+    }
+    reserve(strings.size(), bytes);
+    for (std::string_view s : strings) {
+      push_back(s);
+    }
+  }
+
+  ~FlatStringList() { delete[] buffer_; }
+
+  // 拷贝时只分配正好需要的大小。
+  FlatStringList(const FlatStringList &other) {
+    reserve(other.count_, other.used_);
+    for (std::string_view s : other) {
+      push_back(s);
+    }
+  }
+
+  FlatStringList &operator=(const FlatStringList &other) {
+    if (this != &other) {
+      FlatStringList copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  // 移动只是转移缓冲区的所有权，不会分配内存，也不会抛出异常。
+  FlatStringList(FlatStringList &&other) noexcept
+      : buffer_(other.buffer_), capacity_(other.capacity_), count_(other.count_),
+        used_(other.used_) {
+    other.buffer_ = nullptr;
+    other.capacity_ = other.count_ = other.used_ = 0;
+  }
+
+  FlatStringList &operator=(FlatStringList &&other) noexcept {
+    if (this != &other) {
+      delete[] buffer_;
+      buffer_ = other.buffer_;
+      capacity_ = other.capacity_;
+      count_ = other.count_;
+      used_ = other.used_;
+      other.buffer_ = nullptr;
+      other.capacity_ = other.count_ = other.used_ = 0;
+    }
+    return *this;
+  }
+
+  // 预先为总共 count 个字符串、bytes 个字节分配空间。
+  void reserve(size_t count, size_t bytes) {
+    if (count > UINT32_MAX / sizeof(uint32_t) || bytes > UINT32_MAX) {
+      throw std::length_error("FlatStringList: size exceeds 4 GiB");
+    }
+    size_t needed = bytes + count * sizeof(uint32_t);
+    if (needed > capacity_) {
+      reallocate(needed);
+    }
+  }
+
+  // 在末尾追加一个字符串（拷贝它的字节）。
+  void push_back(std::string_view s) {
+    size_t needed = used_ + s.size() + (count_ + 1) * sizeof(uint32_t);
+    if (needed > capacity_) {
+      // 翻倍后超过 32 位的上限时，只增长到上限；needed 本身超过上限时，reallocate 会抛出异常。
+      size_t doubled = 2 * static_cast<size_t>(capacity_);
+      if (doubled > UINT32_MAX) {
+        doubled = UINT32_MAX;
+      }
+      reallocate(needed > doubled ? needed : doubled);
+    }
+    std::memcpy(buffer_ + used_, s.data(), s.size());
+    used_ += static_cast<uint32_t>(s.size());
+    set_end(count_, used_);
+    ++count_;
+  }
+
+  // 第 i 个字符串。返回的 string_view 在下一次修改列表之前有效。
+  std::string_view operator[](size_t i) const {
+    uint32_t begin = i == 0 ? 0 : end_of(i - 1);
+    return std::string_view(buffer_ + begin, end_of(i) - begin);
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+  // 第 i 个字符串的结束偏移存放在缓冲区末尾往前数的第 i + 1 个 uint32_t 中。
+  uint32_t end_of(size_t i) const {
+    uint32_t end;
+    std::memcpy(&end, buffer_ + capacity_ - (i + 1) * sizeof(uint32_t), sizeof(end));
+    return end;
+  }
+  void set_end(size_t i, uint32_t end) {
+    std::memcpy(buffer_ + capacity_ - (i + 1) * sizeof(uint32_t), &end, sizeof(end));
+  }
+
+  // 换一块新的缓冲区：字符拷贝到开头，偏移拷贝到末尾。
+  // 偏移和大小都是 32 位整数，所以缓冲区不能超过 UINT32_MAX 个字节，
+  // 否则截断后的 capacity_ 会让 set_end 和 end_of 读写错误的位置。
+  void reallocate(size_t capacity) {
+    if (capacity > UINT32_MAX) {
+      throw std::length_error("FlatStringList: size exceeds 4 GiB");
+    }
+    char *buffer = new char[capacity];
+    size_t ends_bytes = count_ * sizeof(uint32_t);
+    if (buffer_ != nullptr) {
+      std::memcpy(buffer, buffer_, used_);
+      std::memcpy(buffer + capacity - ends_bytes, buffer_ + capacity_ - ends_bytes, ends_bytes);
+      delete[] buffer_;
+    }
+    buffer_ = buffer;
+    capacity_ = static_cast<uint32_t>(capacity);
+  }
+
+  // 所有数据都在一块缓冲区中，就像数据库中的"分槽页"（slotted page）：
+  // 字符串的字节从缓冲区的开头向后增长，每个字符串的结束偏移从缓冲区的末尾向前增长。
+  // 只保存结束偏移：第 i 个字符串的开始偏移就是第 i - 1 个字符串的结束偏移。
+  // 空列表不需要任何堆内存。偏移和大小使用 32 位整数，一个列表最多可以保存 4 GiB 的数据
+  // （包括偏移本身），超过时 reserve 和 push_back 抛出 std::length_error。
+  char *buffer_ = nullptr;
+  uint32_t capacity_ = 0;
+  uint32_t count_ = 0;
+  uint32_t used_ = 0;
+};
+
+// 与 move_constructors.cpp 中的 Person 相同，只是昵称存放在 FlatStringList 中。
+// 移动构造函数和移动赋值运算符不再打印，并且标记为 noexcept。
+class Person {
+public:
+  Person() : age_(0), valid_(true) {}
+
+  Person(uint32_t age, FlatStringList &&nicknames)
+      : age_(age), nicknames_(std::move(nicknames)), valid_(true) {}
+
+  Person(Person &&person) noexcept
+      : age_(person.age_), nicknames_(std::move(person.nicknames_)), valid_(true) {
+    person.valid_ = false;
+  }
+
+  Person &operator=(Person &&other) noexcept {
+    age_ = other.age_;
+    nicknames_ = std::move(other.nicknames_);
+    valid_ = true;
+    other.valid_ = false;
+    return *this;
+  }
+
+  Person(const Person &) = delete;
+  Person &operator=(const Person &) = delete;
+
+  uint32_t GetAge() { return age_; }
+
+  // 返回 std::string_view 而不是 std::string &：昵称的字符直接位于 FlatStringList 的字节数组中。
+  std::string_view GetNicknameAtI(size_t i) { return nicknames_[i]; }
+
+  void PrintValid() {
+    if (valid_) {
+      std::cout << "Object is valid." << std::endl;
+    } else {
+      std::cout << "Object is invalid." << std::endl;
+    }
+  }
+
+private:
+  uint32_t age_;
+  FlatStringList nicknames_;
+  bool valid_;
+};
+
+// 对照组：与 move_constructors.cpp 中相同的存储方式。
+class VectorPerson {
+public:
+  VectorPerson(uint32_t age, std::vector<std::string> &&nicknames)
+      : age_(age), nicknames_(std::move(nicknames)), valid_(true) {}
+
+  std::string &GetNicknameAtI(size_t i) { return nicknames_[i]; }
+
+private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  bool valid_;
+};
+
+int main() {
+  // 首先，我们像 move_constructors.cpp 中那样构造并移动一个 Person。
+  Person andy(15445, {"andy", "pavlo"});
+  std::cout << "Printing andy's validity: ";
+  andy.PrintValid();
+  Person andy1(std::move(andy));
+  std::cout << "Printing andy1's validity: ";
+  andy1.PrintValid();
+  std::cout << "andy1's nicknames: " << andy1.GetNicknameAtI(0) << " " << andy1.GetNicknameAtI(1)
+            << std::endl;
+
+  FlatStringList list = {"short", "a nickname that does not fit in SSO"};
+  list.push_back("third");
+  std::cout << "Iterating over a FlatStringList:";
+  for (std::string_view s : list) {
+    std::cout << " [" << s << "]";
+  }
+  std::cout << std::endl;
+  FlatStringList copy = list;
+  copy.push_back("fourth");
+  std::cout << "list has " << list.size() << " strings, copy has " << copy.size() << ", copy[3] = "
+            << copy[3] << std::endl;
+
+  // 基准测试：n 个 Person，每个有三个昵称，其中一个超过 15 个字符（放不进 SSO 缓冲区）。
+  // 比较两种存储方式的构造时间、堆内存占用（字节数和块数）和读取所有昵称的时间。
+  const size_t n = 1000000;
+  const char *long_names[] = {"professor-of-databases", "carnegie-mellon-university",
+                              "query-optimization-fan"};
+  using Clock = std::chrono::steady_clock;
+  size_t checksum = 0;
+
+  {
+    size_t before = live_bytes, before_blocks = live_blocks;
+    auto start = Clock::now();
+    std::vector<VectorPerson> people;
+    people.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      people.emplace_back(static_cast<uint32_t>(i),
+                          std::vector<std::string>{"andy", "pavlo", long_names[i % 3]});
+    }
+    std::chrono::duration<double, std::milli> build = Clock::now() - start;
+    size_t bytes = live_bytes - before, blocks = live_blocks - before_blocks;
+    start = Clock::now();
+    for (auto &person : people) {
+      for (size_t k = 0; k < 3; ++k) {
+        checksum += person.GetNicknameAtI(k).size();
+      }
+    }
+    std::chrono::duration<double, std::milli> read = Clock::now() - start;
+    std::cout << "std::vector<std::string>: build " << build.count() << " ms, "
+              << bytes / (1024 * 1024) << " MiB in " << blocks << " blocks, read "
+              << read.count() << " ms\n";
+  }
+  {
+    size_t before = live_bytes, before_blocks = live_blocks;
+    auto start = Clock::now();
+    std::vector<Person> people;
+    people.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      people.emplace_back(static_cast<uint32_t>(i),
+                          FlatStringList{"andy", "pavlo", long_names[i % 3]});
+    }
+    std::chrono::duration<double, std::milli> build = Clock::now() - start;
+    size_t bytes = live_bytes - before, blocks = live_blocks - before_blocks;
+    start = Clock::now();
+    for (auto &person : people) {
+      for (size_t k = 0; k < 3; ++k) {
+        checksum += person.GetNicknameAtI(k).size();
+      }
+    }
+    std::chrono::duration<double, std::milli> read = Clock::now() - start;
+    std::cout << "FlatStringList:           build " << build.count() << " ms, "
+              << bytes / (1024 * 1024) << " MiB in " << blocks << " blocks, read "
+              << read.count() << " ms\n";
+  }
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
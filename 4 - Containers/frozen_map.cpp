@@ -0,0 +1,273 @@
+// 在 auto.cpp 和 unordered_maps.cpp 中，我们用 {"andy", 445}, {"jignesh", 645} 这样的字面量构造 map。
+// 这些键在编译时就完全已知，而且程序运行期间从不改变，
+// 但 std::unordered_map 仍然要在运行时为每个元素分配节点、在每次查找时求哈希、处理冲突。
+
+// 这个文件实现一个"冻结"的 map（frozen map）：它在编译时由一组固定的键值对构造，
+// 之后只能查找，不能修改。构造时，我们为这组键计算一个"最小完美哈希函数"
+// （minimal perfect hash function）：它把 N 个键一一映射到 0 ~ N-1 这 N 个槽位上，没有任何冲突。
+// 因此一次查找只需要：对键求一次哈希，找到唯一可能的槽位，再做一次键比较。
+// 整个 map 是一个 constexpr 对象，存放在程序的只读数据段中，没有任何堆分配。
+
+// 我们使用的构造算法叫做 "hash and displace"（CHD 算法的简化版本）：
+//   1. 用哈希值 h 的一部分把键分到 N 个桶中，每个桶平均只有一个键；
+//   2. 从最大的桶开始，为每个桶寻找一个"种子"（seed），
+//      使得这个桶里所有的键用 mix(h, seed) % N 计算出的槽位都还没被占用；
+//   3. 只有一个键的桶不需要搜索种子，直接放进任意一个空槽位，并在种子中记下这个槽位。
+// 查找时，先由 h 找到桶，读出它的种子，再计算槽位。
+
+// 包含 std::array。
+#include <array>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t、uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::logic_error。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 unordered_map 容器库头文件，作为基准测试的对照组。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// FNV-1a 字符串哈希。它足够简单，可以在 constexpr 函数中求值。
+constexpr uint64_t fnv1a(std::string_view str) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// 把字符串哈希值和种子混合成一个新的整数。它只做整数运算，不再遍历字符串。
+constexpr uint64_t mix(uint64_t h, uint64_t seed) {
+  uint64_t x = h ^ (seed * 0x9E3779B97F4A7C15ULL);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// 冻结 map 中的一个元素。我们不使用 std::pair，
+// 因为 std::pair 的赋值运算符直到 C++20 才是 constexpr 的。
+template <typename V> struct Entry {
+  std::string_view key{};
+  V value{};
+};
+
+template <typename V, size_t N> class FrozenMap {
+  static_assert(N > 0, "FrozenMap needs at least one key");
+
+  // 种子的最高位为 1 时，低 31 位直接就是槽位编号（只有一个键的桶）。
+  static constexpr uint32_t kDirect = 0x80000000U;
+
+public:
+  // 构造函数在编译时运行。如果键有重复，或者找不到合适的种子，
+  // 会执行 throw 表达式，这在常量求值中是不允许的，因此会变成编译错误。
+  constexpr explicit FrozenMap(const Entry<V> (&items)[N]) : slots_{}, seeds_{} {
+    std::array<uint64_t, N> hashes{};
+    std::array<size_t, N> bucket_sizes{};
+    for (size_t i = 0; i < N; ++i) {
+      hashes[i] = fnv1a(items[i].key);
+      ++bucket_sizes[hashes[i] % N];
+      for (size_t j = 0; j < i; ++j) {
+        if (items[i].key == items[j].key) {
+          throw std::logic_error("duplicate key in FrozenMap");
+        }
+      }
+    }
+
+    // 按桶的大小从大到小排序（插入排序，constexpr 友好）。
+    std::array<size_t, N> order{};
+    for (size_t b = 0; b < N; ++b) {
+      size_t pos = b;
+      while (pos > 0 && bucket_sizes[order[pos - 1]] < bucket_sizes[b]) {
+        order[pos] = order[pos - 1];
+        --pos;
+      }
+      order[pos] = b;
+    }
+
+    std::array<bool, N> used{};
+    for (size_t k = 0; k < N; ++k) {
+      size_t bucket = order[k];
+      if (bucket_sizes[bucket] == 0) {
+        break;
+      }
+      // 收集这个桶里的所有键。
+      std::array<size_t, N> members{};
+      size_t count = 0;
+      for (size_t i = 0; i < N; ++i) {
+        if (hashes[i] % N == bucket) {
+          members[count++] = i;
+        }
+      }
+
+      if (count == 1) {
+        size_t slot = 0;
+        while (used[slot]) {
+          ++slot;
+        }
+        used[slot] = true;
+        slots_[slot] = items[members[0]];
+        seeds_[bucket] = kDirect | static_cast<uint32_t>(slot);
+        continue;
+      }
+
+      // 为有多个键的桶搜索种子。
+      for (uint32_t seed = 1;; ++seed) {
+        if (seed == kDirect) {
+          throw std::logic_error("no perfect hash seed found");
+        }
+        std::array<size_t, N> slots{};
+        bool ok = true;
+        for (size_t m = 0; m < count && ok; ++m) {
+          slots[m] = mix(hashes[members[m]], seed) % N;
+          ok = !used[slots[m]];
+          for (size_t p = 0; p < m && ok; ++p) {
+            ok = slots[p] != slots[m];
+          }
+        }
+        if (ok) {
+          for (size_t m = 0; m < count; ++m) {
+            used[slots[m]] = true;
+            slots_[slots[m]] = items[members[m]];
+          }
+          seeds_[bucket] = seed;
+          break;
+        }
+      }
+    }
+  }
+
+  // 查找 key，找到时返回指向值的指针，否则返回 nullptr。
+  constexpr const V *find(std::string_view key) const {
+    const Entry<V> &entry = slots_[slot_of(key)];
+    return entry.key == key ? &entry.value : nullptr;
+  }
+
+  constexpr size_t count(std::string_view key) const { return find(key) != nullptr ? 1 : 0; }
+
+  // 与 std::unordered_map::at 相同，键不存在时抛出 std::out_of_range。
+  constexpr const V &at(std::string_view key) const {
+    const V *value = find(key);
+    if (value == nullptr) {
+      throw std::out_of_range("key not in FrozenMap");
+    }
+    return *value;
+  }
+
+  constexpr size_t size() const { return N; }
+  constexpr const Entry<V> *begin() const { return slots_.data(); }
+  constexpr const Entry<V> *end() const { return slots_.data() + N; }
+
+private:
+  constexpr size_t slot_of(std::string_view key) const {
+    uint64_t h = fnv1a(key);
+    uint32_t seed = seeds_[h % N];
+    if (seed & kDirect) {
+      return seed & ~kDirect;
+    }
+    return mix(h, seed) % N;
+  }
+
+  std::array<Entry<V>, N> slots_;
+  std::array<uint32_t, N> seeds_;
+};
+
+// 辅助函数，让编译器从初始化列表中推导出 N。
+template <typename V, size_t N>
+constexpr FrozenMap<V, N> make_frozen_map(const Entry<V> (&items)[N]) {
+  return FrozenMap<V, N>(items);
+}
+
+// 与 auto.cpp 中相同的数据，但是在编译时构造。
+constexpr auto kCourses = make_frozen_map<int>({{"andy", 445}, {"jignesh", 645}});
+
+// 查找本身也可以在编译时完成。
+static_assert(*kCourses.find("andy") == 445, "compile-time lookup");
+static_assert(kCourses.count("spam") == 0, "compile-time miss");
+
+// 基准测试用的静态查找表：C++ 关键字及其编号，这是编译器和语法高亮工具中常见的表。
+constexpr auto kKeywords = make_frozen_map<int>({
+    {"alignas", 0},    {"alignof", 1},   {"and", 2},         {"asm", 3},
+    {"auto", 4},       {"bool", 5},      {"break", 6},       {"case", 7},
+    {"catch", 8},      {"char", 9},      {"class", 10},      {"const", 11},
+    {"constexpr", 12}, {"const_cast", 13}, {"continue", 14}, {"decltype", 15},
+    {"default", 16},   {"delete", 17},   {"do", 18},         {"double", 19},
+    {"dynamic_cast", 20}, {"else", 21},  {"enum", 22},       {"explicit", 23},
+    {"export", 24},    {"extern", 25},   {"false", 26},      {"float", 27},
+    {"for", 28},       {"friend", 29},   {"goto", 30},       {"if", 31},
+    {"inline", 32},    {"int", 33},      {"long", 34},       {"mutable", 35},
+    {"namespace", 36}, {"new", 37},      {"noexcept", 38},   {"not", 39},
+    {"nullptr", 40},   {"operator", 41}, {"or", 42},         {"private", 43},
+    {"protected", 44}, {"public", 45},   {"register", 46},   {"reinterpret_cast", 47},
+    {"return", 48},    {"short", 49},    {"signed", 50},     {"sizeof", 51},
+    {"static", 52},    {"static_assert", 53}, {"static_cast", 54}, {"struct", 55},
+    {"switch", 56},    {"template", 57}, {"this", 58},       {"thread_local", 59},
+    {"throw", 60},     {"true", 61},     {"try", 62},        {"typedef", 63},
+    {"typeid", 64},    {"typename", 65}, {"union", 66},      {"unsigned", 67},
+    {"using", 68},     {"virtual", 69},  {"void", 70},       {"volatile", 71},
+    {"wchar_t", 72},   {"while", 73},    {"xor", 74},
+});
+
+int main() {
+  // 冻结 map 可以像普通 map 一样使用。
+  if (const int *value = kCourses.find("jignesh")) {
+    std::cout << "Found key jignesh with value " << *value << std::endl;
+  }
+  std::cout << "Printing elements in frozen map...\n";
+  for (const auto &elem : kCourses) {
+    std::cout << "(" << elem.key << "," << elem.value << ") ";
+  }
+  std::cout << std::endl;
+
+  // 基准测试：用一段包含关键字和普通标识符的"源代码"单词流反复查表。
+  std::unordered_map<std::string, int> runtime_map;
+  for (const auto &elem : kKeywords) {
+    runtime_map.emplace(std::string(elem.key), elem.value);
+  }
+  const char *identifiers[] = {"x", "value", "count", "result", "index", "buffer"};
+  std::vector<std::string> words;
+  for (size_t i = 0; i < 4096; ++i) {
+    if (i % 2 == 0) {
+      words.emplace_back((kKeywords.begin() + i % kKeywords.size())->key);
+    } else {
+      words.emplace_back(identifiers[i % 6]);
+    }
+  }
+
+  const int rounds = 2000;
+  using Clock = std::chrono::steady_clock;
+  long long sum = 0;
+
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (const auto &word : words) {
+      auto it = runtime_map.find(word);
+      sum += it != runtime_map.end() ? it->second : -1;
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  std::cout << "std::unordered_map lookup: " << elapsed.count() / (rounds * words.size())
+            << " ns\n";
+
+  start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (const auto &word : words) {
+      const int *value = kKeywords.find(word);
+      sum += value != nullptr ? *value : -1;
+    }
+  }
+  elapsed = Clock::now() - start;
+  std::cout << "FrozenMap lookup:          " << elapsed.count() / (rounds * words.size())
+            << " ns\n";
+  std::cout << "Checksum: " << sum << "\n";
+
+  return 0;
+}
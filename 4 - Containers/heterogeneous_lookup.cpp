@@ -0,0 +1,168 @@
+// 在 unordered_maps.cpp 中，我们写过 map.find("jignesh")、map.count("spam") 和 map.erase("eggs")。
+// 这些调用看起来很便宜，但 map 的键类型是 std::string，
+// 而 find/count/erase 的参数类型是 const std::string &，
+// 所以每次调用都会先用字符串字面量构造一个临时的 std::string。
+// 短字符串可以放进 std::string 内部的小缓冲区（small string optimization, SSO，通常 15 个字符），
+// 一旦键更长，每次查找都会在堆上分配一次内存，查完再释放。
+
+// C++20 为无序容器加入了"异构查找"（heterogeneous lookup）：
+// 如果哈希函数和相等比较函数都声明了 is_transparent 类型，
+// find/count/contains/equal_range 就接受任何能被它们处理的类型，比如 std::string_view，
+// 而不必先转换为 std::string。
+// 因此这个文件需要用 C++20 编译（见 CMakeLists.txt 中对这个目标的设置），
+// 其余文件仍然使用 C++17。
+
+// 注意：无序容器的 erase 直到 C++23 才支持异构键，
+// 所以下面的 erase_key 先用异构的 find 找到元素，再按迭代器删除，同样不需要分配内存。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::malloc 和 std::free。
+#include <cstdlib>
+// 包含 std::equal_to<>。
+#include <functional>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::bad_alloc。
+#include <new>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 unordered_map 容器库头文件。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 为了在基准测试中统计堆分配的次数，我们替换全局的 operator new 和 operator delete。
+// 每次调用 operator new 都会让 allocation_count 加一。
+static size_t allocation_count = 0;
+
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// StringHash 是一个"透明"的哈希函数对象。
+// 它对 std::string、std::string_view 和 const char * 给出相同的哈希值，
+// 并通过 is_transparent 告诉容器它可以直接处理这些类型。
+struct StringHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+  size_t operator()(const std::string &str) const { return (*this)(std::string_view(str)); }
+  size_t operator()(const char *str) const { return (*this)(std::string_view(str)); }
+};
+
+// StringEqual 是对应的透明相等比较函数。
+// std::equal_to<>（即 std::equal_to<void>）本身就是透明的，
+// 它对 std::string 和 std::string_view 调用 operator==，不会构造临时对象。
+using StringEqual = std::equal_to<>;
+
+// StringMap 是一个键为 std::string 的 unordered_map，
+// 它的 find/count/contains 可以直接接受 std::string_view 或 const char *。
+template <typename V> using StringMap = std::unordered_map<std::string, V, StringHash, StringEqual>;
+
+// 按 std::string_view 删除一个键，返回删除的元素个数。
+template <typename V> size_t erase_key(StringMap<V> &map, std::string_view key) {
+  auto it = map.find(key);
+  if (it == map.end()) {
+    return 0;
+  }
+  map.erase(it);
+  return 1;
+}
+
+// 对 fn 计时，同时统计它执行期间发生的堆分配次数。
+template <typename Fn> void measure(const char *name, size_t ops, Fn fn) {
+  size_t before = allocation_count;
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "  " << name << ": " << elapsed.count() / static_cast<double>(ops) << " ns/op, "
+            << allocation_count - before << " allocations\n";
+}
+
+int main() {
+  // 首先，我们用 StringMap 重复 unordered_maps.cpp 中的操作。
+  // 插入仍然需要构造 std::string（键必须被存储起来），但查找和删除不再需要。
+  StringMap<int> map;
+  map.insert({{"foo", 2}, {"jignesh", 445}, {"spam", 1}, {"eggs", 2}, {"garlic rice", 3}});
+
+  auto result = map.find("jignesh");
+  if (result != map.end()) {
+    std::cout << "Found key " << result->first << " with value " << result->second << std::endl;
+  }
+
+  std::string_view spam = "spam";
+  if (map.count(spam) == 1) {
+    std::cout << "A key-value pair with key spam exists in the unordered map.\n";
+  }
+
+  erase_key(map, "eggs");
+  if (!map.contains("eggs")) {
+    std::cout << "Key-value pair with key eggs does not exist in the unordered map.\n";
+  }
+
+  // 接下来，我们用比 SSO 缓冲区更长的键比较两种 map 的查找代价。
+  // 普通的 std::unordered_map<std::string, int> 每次用 const char * 查找都会分配一次内存，
+  // 而 StringMap 一次都不会。
+  const size_t n = 100000;
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back("a-rather-long-key-that-does-not-fit-in-sso-" + std::to_string(i));
+  }
+  std::vector<const char *> probes;
+  for (const auto &key : keys) {
+    probes.push_back(key.c_str());
+  }
+
+  std::unordered_map<std::string, int> plain;
+  StringMap<int> transparent;
+  for (size_t i = 0; i < n; ++i) {
+    plain.emplace(keys[i], static_cast<int>(i));
+    transparent.emplace(keys[i], static_cast<int>(i));
+  }
+
+  long long sum = 0;
+  std::cout << "Looking up " << n << " long keys through const char *:\n";
+  measure("std::unordered_map find ", n, [&]() {
+    for (const char *probe : probes) {
+      sum += plain.find(probe)->second;
+    }
+  });
+  measure("StringMap find          ", n, [&]() {
+    for (const char *probe : probes) {
+      sum += transparent.find(probe)->second;
+    }
+  });
+  measure("std::unordered_map count", n, [&]() {
+    for (const char *probe : probes) {
+      sum += static_cast<long long>(plain.count(probe));
+    }
+  });
+  measure("StringMap count         ", n, [&]() {
+    for (const char *probe : probes) {
+      sum += static_cast<long long>(transparent.count(probe));
+    }
+  });
+  measure("std::unordered_map erase", n, [&]() {
+    for (const char *probe : probes) {
+      sum += static_cast<long long>(plain.erase(probe));
+    }
+  });
+  measure("StringMap erase_key     ", n, [&]() {
+    for (const char *probe : probes) {
+      sum += static_cast<long long>(erase_key(transparent, probe));
+    }
+  });
+  std::cout << "Checksum: " << sum << "\n";
+
+  return 0;
+}
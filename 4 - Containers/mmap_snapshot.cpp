@@ -0,0 +1,295 @@
+// 很多服务在启动时都要从原始数据重新构造一个很大的 std::unordered_map<std::string, int>
+// （就像 unordered_maps.cpp 中的那个 map），
+// 这需要解析输入、为每个键分配内存、逐个插入，数据量大时要花几十秒。
+
+// 这个文件实现一种"一次写入"的二进制快照格式，以及一个只读的 map 视图。
+// 快照文件本身就是一个已经建好的哈希表：
+//   - 文件头：魔数、版本号、元素个数、槽位个数（2 的幂）；
+//   - 槽位数组：每个槽位记录键的哈希值、键在字符串池中的偏移和长度，以及值；
+//   - 字符串池：所有键的字节紧挨着存放，槽位通过偏移引用它们，而不是通过指针。
+// 因为文件中只有偏移，没有指针，所以它可以被映射到任何地址上直接使用。
+// SnapshotView 用 mmap 把文件映射到内存中，find/count 直接在映射的内存上进行线性探测，
+// 不需要解析，也不需要分配内存；只有真正被访问到的页才会由操作系统从页缓存中载入。
+
+// 注意：为了简单起见，文件使用本机字节序（在 x86 和 ARM 上都是小端序），
+// 所以快照只能在字节序相同的机器之间共享。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t、uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::memcmp、std::memcpy。
+#include <cstring>
+// 包含 std::filesystem，用于获取临时目录。
+#include <filesystem>
+// 包含 std::ifstream、std::ofstream。
+#include <fstream>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::runtime_error、std::length_error。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 unordered_map 容器库头文件。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含 POSIX 的 open、fstat、mmap、munmap、close。
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 快照中的哈希函数必须在不同进程、不同编译器之间保持一致，
+// 而 std::hash 并不保证这一点，所以我们使用固定的 FNV-1a。
+uint64_t snapshot_hash(std::string_view str) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// 文件头和槽位的布局。两者的大小都是 8 的倍数，所以槽位数组自然对齐。
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t slot_count;
+  uint64_t pool_size;
+};
+
+struct SnapshotSlot {
+  uint64_t hash;
+  uint32_t key_offset;
+  uint32_t key_length;
+  int32_t value;
+  uint32_t occupied;
+};
+
+constexpr char kSnapshotMagic[8] = {'B', 'C', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+// 把一个 map 写成快照文件。槽位数至少是元素个数的两倍，保证探测序列很短。
+// 文件中的元素个数、键的偏移和长度都是 32 位的，放不下时抛出 std::length_error，
+// 而不是截断之后写出一个读者会信任的损坏文件。
+void write_snapshot(const std::string &path, const std::unordered_map<std::string, int> &map) {
+  if (map.size() > UINT32_MAX) {
+    throw std::length_error("snapshot holds at most 2^32 - 1 keys");
+  }
+  uint64_t slot_count = 16;
+  while (slot_count < map.size() * 2) {
+    slot_count *= 2;
+  }
+  std::vector<SnapshotSlot> slots(slot_count);
+  std::string pool;
+  for (const auto &elem : map) {
+    // 键的偏移是 pool.size()，键的末尾是 pool.size() + 键长，两者（以及键长）都必须放得进 32 位。
+    if (elem.first.size() > UINT32_MAX - pool.size()) {
+      throw std::length_error("snapshot string pool exceeds 4 GiB");
+    }
+    uint64_t hash = snapshot_hash(elem.first);
+    uint64_t index = hash & (slot_count - 1);
+    while (slots[index].occupied) {
+      index = (index + 1) & (slot_count - 1);
+    }
+    slots[index] = {hash, static_cast<uint32_t>(pool.size()),
+                    static_cast<uint32_t>(elem.first.size()), elem.second, 1};
+    pool += elem.first;
+  }
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+  header.version = kSnapshotVersion;
+  header.count = static_cast<uint32_t>(map.size());
+  header.slot_count = slot_count;
+  header.pool_size = pool.size();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(slots.data()),
+            static_cast<std::streamsize>(slots.size() * sizeof(SnapshotSlot)));
+  out.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+  if (!out) {
+    throw std::runtime_error("failed to write snapshot " + path);
+  }
+}
+
+// SnapshotView 是快照文件的只读视图。它拥有映射的内存，析构时解除映射，
+// 所以它和 unique_ptr 一样不能被拷贝，只能被移动。
+class SnapshotView {
+public:
+  explicit SnapshotView(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("cannot open snapshot " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+      ::close(fd);
+      throw std::runtime_error("snapshot is too small: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立之后就可以关闭文件描述符了，映射仍然有效。
+    ::close(fd);
+    if (data_ == MAP_FAILED) {
+      data_ = nullptr;
+      throw std::runtime_error("cannot mmap snapshot " + path);
+    }
+
+    // 校验文件头：魔数、版本，以及槽位数组和字符串池恰好占满文件的剩余部分。
+    // 文件头中的数字来自文件，可能是任意值，所以用除法和减法比较，避免乘法和加法溢出。
+    // 这里不逐个检查槽位（那样打开文件就要读遍整个槽位数组），
+    // 槽位中的偏移和长度由 find 在使用前检查。
+    const auto *header = static_cast<const SnapshotHeader *>(data_);
+    uint64_t slot_count = header->slot_count;
+    uint64_t remaining = size_ - sizeof(SnapshotHeader);
+    if (std::memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        header->version != kSnapshotVersion || slot_count == 0 ||
+        (slot_count & (slot_count - 1)) != 0 || header->count >= slot_count ||
+        slot_count > remaining / sizeof(SnapshotSlot) ||
+        header->pool_size != remaining - slot_count * sizeof(SnapshotSlot)) {
+      ::munmap(data_, size_);
+      data_ = nullptr;
+      throw std::runtime_error("corrupt snapshot " + path);
+    }
+    count_ = header->count;
+    mask_ = slot_count - 1;
+    pool_size_ = header->pool_size;
+    slots_ = reinterpret_cast<const SnapshotSlot *>(header + 1);
+    pool_ = reinterpret_cast<const char *>(slots_ + slot_count);
+  }
+
+  ~SnapshotView() {
+    if (data_ != nullptr) {
+      ::munmap(data_, size_);
+    }
+  }
+
+  SnapshotView(const SnapshotView &) = delete;
+  SnapshotView &operator=(const SnapshotView &) = delete;
+  SnapshotView(SnapshotView &&other) noexcept
+      : data_(other.data_), size_(other.size_), count_(other.count_), mask_(other.mask_),
+        pool_size_(other.pool_size_), slots_(other.slots_), pool_(other.pool_) {
+    other.data_ = nullptr;
+  }
+
+  // 查找 key，直接在映射的内存上做线性探测。
+  // 损坏的文件可能所有槽位都被占用，所以最多探测 mask_ + 1 个槽位，保证循环会结束；
+  // 键的偏移和长度也来自文件，读取字符串池之前先检查它们没有越界。
+  std::optional<int> find(std::string_view key) const {
+    uint64_t hash = snapshot_hash(key);
+    uint64_t index = hash & mask_;
+    for (uint64_t probes = 0; probes <= mask_; ++probes, index = (index + 1) & mask_) {
+      const SnapshotSlot &slot = slots_[index];
+      if (!slot.occupied) {
+        return std::nullopt;
+      }
+      if (slot.hash == hash &&
+          uint64_t{slot.key_offset} + slot.key_length <= pool_size_ &&
+          key == std::string_view(pool_ + slot.key_offset, slot.key_length)) {
+        return slot.value;
+      }
+    }
+    return std::nullopt;
+  }
+
+  size_t count(std::string_view key) const { return find(key) ? 1 : 0; }
+
+  size_t size() const { return count_; }
+
+private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+  size_t count_ = 0;
+  uint64_t mask_ = 0;
+  uint64_t pool_size_ = 0;
+  const SnapshotSlot *slots_ = nullptr;
+  const char *pool_ = nullptr;
+};
+
+int main(int argc, char **argv) {
+  std::filesystem::path dir = std::filesystem::temp_directory_path();
+  std::string snapshot_path = (dir / "bootcamp_map.snapshot").string();
+  std::string text_path = (dir / "bootcamp_map.txt").string();
+
+  // 首先，我们把 unordered_maps.cpp 中的 map 写成快照，再通过视图读取它。
+  std::unordered_map<std::string, int> map;
+  map.insert({{"foo", 2}, {"jignesh", 445}, {"spam", 15}, {"bacon", 5}});
+  write_snapshot(snapshot_path, map);
+  {
+    SnapshotView view(snapshot_path);
+    if (auto value = view.find("jignesh")) {
+      std::cout << "Found key jignesh with value " << *value << std::endl;
+    }
+    if (view.count("eggs") == 0) {
+      std::cout << "Key eggs does not exist in the snapshot.\n";
+    }
+  }
+
+  // 基准测试：n 个键（默认一百万，可以通过第一个命令行参数修改）。
+  // 传统的启动方式是从文本文件中逐行解析并重建 map；
+  // 快照方式只需要打开并映射快照文件。
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  std::vector<std::string> keys;
+  {
+    std::unordered_map<std::string, int> big;
+    std::ofstream text(text_path, std::ios::trunc);
+    for (size_t i = 0; i < n; ++i) {
+      keys.push_back("user:" + std::to_string(i * 2654435761ULL % 1000000007ULL));
+      big[keys.back()] = static_cast<int>(i);
+      text << keys.back() << ' ' << i << '\n';
+    }
+    write_snapshot(snapshot_path, big);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  long long sum = 0;
+
+  auto start = Clock::now();
+  std::unordered_map<std::string, int> rebuilt;
+  {
+    std::ifstream text(text_path);
+    std::string key;
+    int value;
+    while (text >> key >> value) {
+      rebuilt.emplace(std::move(key), value);
+    }
+  }
+  std::chrono::duration<double, std::milli> rebuild_ms = Clock::now() - start;
+
+  start = Clock::now();
+  SnapshotView view(snapshot_path);
+  std::chrono::duration<double, std::milli> open_ms = Clock::now() - start;
+
+  std::cout << n << " keys:\n";
+  std::cout << "  startup: rebuild from text " << rebuild_ms.count() << " ms, open snapshot "
+            << open_ms.count() << " ms\n";
+
+  start = Clock::now();
+  for (const auto &key : keys) {
+    sum += rebuilt.find(key)->second;
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  std::cout << "  lookup: std::unordered_map " << elapsed.count() / static_cast<double>(n)
+            << " ns";
+
+  start = Clock::now();
+  for (const auto &key : keys) {
+    sum += *view.find(key);
+  }
+  elapsed = Clock::now() - start;
+  std::cout << ", SnapshotView " << elapsed.count() / static_cast<double>(n) << " ns\n";
+  std::cout << "Checksum: " << sum << "\n";
+
+  std::filesystem::remove(snapshot_path);
+  std::filesystem::remove(text_path);
+  return 0;
+}
@@ -0,0 +1,373 @@
+// 当 std::vector 的容量不够时，它会分配一块更大的内存，然后把旧内存中的每个元素"搬"过去：
+// 对每个元素调用一次移动构造函数（或者拷贝构造函数），再对旧元素调用一次析构函数。
+// move_constructors.cpp 中 Person 的移动构造函数没有标记 noexcept，每次调用还会打印一行文字，
+// 所以 std::vector<Person> 每次扩容都要逐个调用它 n 次。
+// （对于可以拷贝的类型，如果移动构造函数不是 noexcept，std::vector 甚至会退回到更慢的拷贝。）
+
+// 但是对于大多数类型，"移动到新位置再销毁旧对象"这一对操作的效果，
+// 和"把对象的字节原样拷贝到新位置，然后忘掉旧对象"完全相同。
+// 例如 Person 只包含一个整数、一个 std::vector 和一个 bool，它们都不保存指向自身的指针。
+// 这样的类型称为"可平凡重定位的"（trivially relocatable）。
+// 对它们来说，扩容、插入、删除时搬动元素只需要一次 memcpy/memmove。
+
+// 编译器无法自动判断一个有自定义移动构造函数的类型是否可平凡重定位，所以这是一个"选择加入"的特征：
+// 类型的作者通过特化 is_trivially_relocatable 来声明这一点。
+// 注意：不是所有类型都满足条件。例如 libstdc++ 中的 std::string 在短字符串优化时保存一个指向自身内部
+// 缓冲区的指针，按字节拷贝之后这个指针会指向旧的内存，所以 std::string 不能被标记。
+
+// 包含 std::rotate、std::move。
+#include <algorithm>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t 的头文件。
+#include <cstdint>
+// 包含 std::memcpy、std::memmove。
+#include <cstring>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 placement new 和 ::operator new。
+#include <new>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::is_trivially_copyable 等类型特征。
+#include <type_traits>
+// 包含 std::move、std::forward。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 默认情况下，只有可以平凡拷贝的类型才被认为可平凡重定位。其他类型需要显式特化。
+template <typename T> struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+// 记录 Person 的移动构造函数被调用了多少次。
+size_t person_moves = 0;
+
+// 与 move_constructors.cpp 中相同的 Person 类，只是移动构造函数和移动赋值运算符
+// 不再打印，而是增加 person_moves 计数（否则基准测试会打印几百万行）。
+class Person {
+public:
+  Person() : age_(0), nicknames_({}), valid_(true) {}
+
+  Person(uint32_t age, std::vector<std::string> &&nicknames)
+      : age_(age), nicknames_(std::move(nicknames)), valid_(true) {}
+
+  Person(Person &&person)
+      : age_(person.age_), nicknames_(std::move(person.nicknames_)), valid_(true) {
+    ++person_moves;
+    person.valid_ = false;
+  }
+
+  Person &operator=(Person &&other) {
+    ++person_moves;
+    age_ = other.age_;
+    nicknames_ = std::move(other.nicknames_);
+    valid_ = true;
+    other.valid_ = false;
+    return *this;
+  }
+
+  Person(const Person &) = delete;
+  Person &operator=(const Person &) = delete;
+
+  uint32_t GetAge() { return age_; }
+  std::string &GetNicknameAtI(size_t i) { return nicknames_[i]; }
+
+  void PrintValid() {
+    if (valid_) {
+      std::cout << "Object is valid." << std::endl;
+    } else {
+      std::cout << "Object is invalid." << std::endl;
+    }
+  }
+
+private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  bool valid_;
+};
+
+// Person 的成员都不指向对象自身，所以可以按字节搬动。
+template <> struct is_trivially_relocatable<Person> : std::true_type {};
+
+// 与 vectors.cpp 中相同的 Point 类（去掉了构造函数中的打印）。
+class Point {
+public:
+  Point() : x_(0), y_(0) {}
+  Point(int x, int y) : x_(x), y_(y) {}
+
+  inline int GetX() const { return x_; }
+  inline int GetY() const { return y_; }
+
+private:
+  int x_;
+  int y_;
+};
+
+// Point 可以平凡拷贝，默认的特征已经能识别它，这里显式特化只是为了表明意图。
+template <> struct is_trivially_relocatable<Point> : std::true_type {};
+
+// 与 wrapper_class.cpp 中相同的 IntPtrManager 类。
+// 它独占一个堆上的 int，移动时把所有权转移给新对象。
+class IntPtrManager {
+public:
+  IntPtrManager() : ptr_(new int(0)) {}
+  IntPtrManager(int val) : ptr_(new int(val)) {}
+  ~IntPtrManager() { delete ptr_; }
+
+  IntPtrManager(IntPtrManager &&other) : ptr_(other.ptr_) { other.ptr_ = nullptr; }
+  IntPtrManager &operator=(IntPtrManager &&other) {
+    if (ptr_ == other.ptr_) {
+      return *this;
+    }
+    delete ptr_;
+    ptr_ = other.ptr_;
+    other.ptr_ = nullptr;
+    return *this;
+  }
+
+  IntPtrManager(const IntPtrManager &) = delete;
+  IntPtrManager &operator=(const IntPtrManager &) = delete;
+
+  int get() const { return *ptr_; }
+
+private:
+  int *ptr_;
+};
+
+// 把 IntPtrManager 按字节搬到新位置并忘掉旧对象，等价于移动之后再销毁旧对象（它的 ptr_ 已经是 nullptr）。
+template <> struct is_trivially_relocatable<IntPtrManager> : std::true_type {};
+
+// 一个简化的 vector。对于可平凡重定位的 T，扩容、插入和删除时用 memcpy/memmove 搬动元素；
+// 对于其他类型，和 std::vector 一样逐个移动构造再析构。
+// 为了简单起见，它不支持拷贝，也不支持对齐要求超过 operator new 默认对齐的类型。
+template <typename T> class RelocatableVector {
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+  static constexpr bool kRelocatable = is_trivially_relocatable<T>::value;
+
+public:
+  RelocatableVector() = default;
+
+  ~RelocatableVector() {
+    clear();
+    ::operator delete(data_);
+  }
+
+  RelocatableVector(RelocatableVector &&other) noexcept
+      : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+    other.data_ = nullptr;
+    other.size_ = other.capacity_ = 0;
+  }
+
+  RelocatableVector(const RelocatableVector &) = delete;
+  RelocatableVector &operator=(const RelocatableVector &) = delete;
+
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    if (size_ == capacity_) {
+      grow(capacity_ == 0 ? 4 : capacity_ * 2);
+    }
+    T *elem = new (data_ + size_) T(std::forward<Args>(args)...);
+    ++size_;
+    return *elem;
+  }
+
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  // 在下标 pos 处插入 value，后面的元素整体后移一位。
+  void insert(size_t pos, T &&value) {
+    if (size_ == capacity_) {
+      grow(capacity_ == 0 ? 4 : capacity_ * 2);
+    }
+    if constexpr (kRelocatable) {
+      std::memmove(static_cast<void *>(data_ + pos + 1), static_cast<const void *>(data_ + pos),
+                   (size_ - pos) * sizeof(T));
+      try {
+        new (data_ + pos) T(std::move(value));
+      } catch (...) {
+        // 构造失败时把后面的元素搬回原位，容器保持不变。
+        std::memmove(static_cast<void *>(data_ + pos), static_cast<const void *>(data_ + pos + 1),
+                     (size_ - pos) * sizeof(T));
+        throw;
+      }
+      ++size_;
+    } else {
+      emplace_back(std::move(value));
+      std::rotate(data_ + pos, data_ + size_ - 1, data_ + size_);
+    }
+  }
+
+  // 删除下标 pos 处的元素，后面的元素整体前移一位。
+  void erase(size_t pos) {
+    if constexpr (kRelocatable) {
+      data_[pos].~T();
+      std::memmove(static_cast<void *>(data_ + pos), static_cast<const void *>(data_ + pos + 1),
+                   (size_ - pos - 1) * sizeof(T));
+    } else {
+      std::move(data_ + pos + 1, data_ + size_, data_ + pos);
+      data_[size_ - 1].~T();
+    }
+    --size_;
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_) {
+      grow(capacity);
+    }
+  }
+
+  void clear() {
+    for (size_t i = 0; i < size_; ++i) {
+      data_[i].~T();
+    }
+    size_ = 0;
+  }
+
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  T *begin() { return data_; }
+  T *end() { return data_ + size_; }
+
+private:
+  // 分配一块新的内存，把所有元素搬过去，再释放旧内存。
+  void grow(size_t new_capacity) {
+    T *new_data = static_cast<T *>(::operator new(new_capacity * sizeof(T)));
+    if constexpr (kRelocatable) {
+      // 搬动之后，旧内存中的字节不再代表任何对象，所以不调用析构函数。
+      if (size_ != 0) {
+        std::memcpy(static_cast<void *>(new_data), static_cast<const void *>(data_),
+                    size_ * sizeof(T));
+      }
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < size_; ++i) {
+          new (new_data + i) T(std::move(data_[i]));
+        }
+      } catch (...) {
+        for (size_t j = 0; j < i; ++j) {
+          new_data[j].~T();
+        }
+        ::operator delete(new_data);
+        throw;
+      }
+      for (size_t j = 0; j < size_; ++j) {
+        data_[j].~T();
+      }
+    }
+    ::operator delete(data_);
+    data_ = new_data;
+    capacity_ = new_capacity;
+  }
+
+  T *data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+// 对一段代码计时，返回毫秒数。
+template <typename Fn> double time_ms(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main() {
+  // 首先，我们像 move_constructors.cpp 中那样使用 Person，但把它们放进两种 vector 中。
+  // std::vector 每次扩容都调用 Person 的移动构造函数，而 RelocatableVector 一次也不调用。
+  {
+    std::vector<Person> people;
+    for (uint32_t i = 0; i < 100; ++i) {
+      people.emplace_back(i, std::vector<std::string>{"andy", "pavlo"});
+    }
+    std::cout << "std::vector<Person>: 100 push_backs, " << person_moves
+              << " move constructor calls\n";
+  }
+  person_moves = 0;
+  {
+    RelocatableVector<Person> people;
+    for (uint32_t i = 0; i < 100; ++i) {
+      people.emplace_back(i, std::vector<std::string>{"andy", "pavlo"});
+    }
+    people.insert(0, Person(15445, {"jignesh", "patel"}));
+    people.erase(50);
+    std::cout << "RelocatableVector<Person>: 100 push_backs, 1 insert, 1 erase, " << person_moves
+              << " move constructor calls\n";
+    std::cout << "First person: age " << people[0].GetAge() << ", nickname "
+              << people[0].GetNicknameAtI(0) << ". ";
+    people[0].PrintValid();
+  }
+
+  // 对于 IntPtrManager 和 Point 也一样。
+  RelocatableVector<IntPtrManager> managers;
+  for (int i = 0; i < 10; ++i) {
+    managers.emplace_back(i);
+  }
+  managers.erase(0);
+  RelocatableVector<Point> points;
+  points.emplace_back(1, 2);
+  points.insert(0, Point(3, 4));
+  std::cout << "managers[0] = " << managers[0].get() << ", points[0] = (" << points[0].GetX()
+            << ", " << points[0].GetY() << ")\n";
+
+  // 基准测试：不预先 reserve，逐个 push_back n 个元素（包含 log2(n) 次扩容），
+  // 以及在头部插入 m 个元素（每次都要把所有元素后移一位）。
+  const size_t n = 2000000;
+  const size_t m = 20000;
+  long long checksum = 0;
+
+  double std_ms = time_ms([&] {
+    std::vector<Person> v;
+    for (size_t i = 0; i < n; ++i) {
+      v.emplace_back(static_cast<uint32_t>(i), std::vector<std::string>{"andy"});
+    }
+    checksum += v.back().GetAge();
+  });
+  double reloc_ms = time_ms([&] {
+    RelocatableVector<Person> v;
+    for (size_t i = 0; i < n; ++i) {
+      v.emplace_back(static_cast<uint32_t>(i), std::vector<std::string>{"andy"});
+    }
+    checksum += v[n - 1].GetAge();
+  });
+  std::cout << "Person, " << n << " push_backs: std::vector " << std_ms
+            << " ms, RelocatableVector " << reloc_ms << " ms\n";
+
+  std_ms = time_ms([&] {
+    std::vector<IntPtrManager> v;
+    for (size_t i = 0; i < n; ++i) {
+      v.emplace_back(static_cast<int>(i));
+    }
+    checksum += v.back().get();
+  });
+  reloc_ms = time_ms([&] {
+    RelocatableVector<IntPtrManager> v;
+    for (size_t i = 0; i < n; ++i) {
+      v.emplace_back(static_cast<int>(i));
+    }
+    checksum += v[n - 1].get();
+  });
+  std::cout << "IntPtrManager, " << n << " push_backs: std::vector " << std_ms
+            << " ms, RelocatableVector " << reloc_ms << " ms\n";
+
+  std_ms = time_ms([&] {
+    std::vector<Person> v;
+    for (size_t i = 0; i < m; ++i) {
+      v.insert(v.begin(), Person(static_cast<uint32_t>(i), {"andy"}));
+    }
+    checksum += v.front().GetAge();
+  });
+  reloc_ms = time_ms([&] {
+    RelocatableVector<Person> v;
+    for (size_t i = 0; i < m; ++i) {
+      v.insert(0, Person(static_cast<uint32_t>(i), {"andy"}));
+    }
+    checksum += v[0].GetAge();
+  });
+  std::cout << "Person, " << m << " inserts at front: std::vector " << std_ms
+            << " ms, RelocatableVector " << reloc_ms << " ms\n";
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
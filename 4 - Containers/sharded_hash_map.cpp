@@ -0,0 +1,252 @@
+// 在这个文件中，我们将实现一个可以被多个线程同时访问的哈希表。
+// unordered_maps.cpp 中的 std::unordered_map 不是线程安全的。
+// 最简单的做法是像 rwlock.cpp 那样，用一把全局的 std::shared_mutex 保护整个 map：
+// 读操作使用 std::shared_lock，写操作使用 std::unique_lock。
+// 但这样一来，任何一个写操作都会阻塞所有其他线程，
+// 而且即使全是读操作，所有线程也都在修改同一把锁的内部计数器，这个缓存行会在各个核之间来回传递。
+
+// 分片（sharding）是一种简单有效的改进：把 map 拆成 2 的幂个独立的分片，
+// 每个分片是一个普通的 std::unordered_map，配有自己的读写锁。
+// 一个键属于哪个分片由它的哈希值决定，所以访问不同分片的线程互不干扰。
+// 每个分片都按缓存行（64 字节）对齐，避免相邻分片的锁落在同一个缓存行上（伪共享，false sharing）。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::hash。
+#include <functional>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 mutex 库头文件（std::unique_lock）。
+#include <mutex>
+// 包含 std::optional。
+#include <optional>
+// 包含 shared mutex 库头文件。
+#include <shared_mutex>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 thread 库头文件。
+#include <thread>
+// 包含 unordered_map 容器库头文件。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+template <typename K, typename V, typename Hash = std::hash<K>> class ShardedHashMap {
+  // 每个分片独占至少一个缓存行。
+  struct alignas(kCacheLineSize) Shard {
+    mutable std::shared_mutex m;
+    std::unordered_map<K, V, Hash> map;
+  };
+
+public:
+  // shard_count 会被向上取整为 2 的幂，这样可以用位与代替取模来选择分片。
+  explicit ShardedHashMap(size_t shard_count = 64) {
+    size_t count = 1;
+    while (count < shard_count) {
+      count *= 2;
+    }
+    mask_ = count - 1;
+    shards_.reset(new Shard[count]);
+  }
+
+  ShardedHashMap(const ShardedHashMap &) = delete;
+  ShardedHashMap &operator=(const ShardedHashMap &) = delete;
+
+  size_t shard_count() const { return mask_ + 1; }
+
+  // 查找 key。由于锁在函数返回时就被释放了，我们不能返回指向元素的引用或迭代器，
+  // 只能返回值的一个拷贝。
+  std::optional<V> find(const K &key) const {
+    const Shard &shard = shard_for(key);
+    std::shared_lock lk(shard.m);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // 插入或覆盖 key 的值。如果 key 是新插入的，返回 true。
+  bool insert_or_assign(const K &key, V value) {
+    Shard &shard = shard_for(key);
+    std::unique_lock lk(shard.m);
+    return shard.map.insert_or_assign(key, std::move(value)).second;
+  }
+
+  // 删除 key，返回删除的元素个数（0 或 1）。
+  size_t erase(const K &key) {
+    Shard &shard = shard_for(key);
+    std::unique_lock lk(shard.m);
+    return shard.map.erase(key);
+  }
+
+  // compute 原子地完成"读取-修改-写回"。
+  // fn 接收当前值的指针（key 不存在时为 nullptr），返回新值；
+  // 如果返回 std::nullopt，就删除 key。返回值是 fn 的结果。
+  // 例如，计数器加一可以写成：
+  //   map.compute(key, [](const int *old) { return std::optional<int>(old ? *old + 1 : 1); });
+  // 注意不要在 fn 中访问同一个 map，否则可能在同一个分片上死锁。
+  template <typename Fn> std::optional<V> compute(const K &key, Fn fn) {
+    Shard &shard = shard_for(key);
+    std::unique_lock lk(shard.m);
+    auto it = shard.map.find(key);
+    std::optional<V> result = fn(it == shard.map.end() ? nullptr : &it->second);
+    if (result) {
+      if (it == shard.map.end()) {
+        shard.map.emplace(key, *result);
+      } else {
+        it->second = *result;
+      }
+    } else if (it != shard.map.end()) {
+      shard.map.erase(it);
+    }
+    return result;
+  }
+
+  // 对每个元素调用 fn(key, value)。每次只对一个分片加读锁，
+  // 所以它可以和其他线程的写操作安全地并发执行，
+  // 但看到的不是整个 map 在某一时刻的快照。
+  template <typename Fn> void for_each(Fn fn) const {
+    for (size_t i = 0; i <= mask_; ++i) {
+      std::shared_lock lk(shards_[i].m);
+      for (const auto &elem : shards_[i].map) {
+        fn(elem.first, elem.second);
+      }
+    }
+  }
+
+  // 与 for_each 相同，但由 thread_count 个线程分别遍历不同的分片。
+  // fn 会被多个线程同时调用，所以它本身必须是线程安全的。
+  template <typename Fn> void parallel_for_each(Fn fn, size_t thread_count) const {
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < thread_count; ++t) {
+      workers.emplace_back([this, &fn, t, thread_count]() {
+        for (size_t i = t; i <= mask_; i += thread_count) {
+          std::shared_lock lk(shards_[i].m);
+          for (const auto &elem : shards_[i].map) {
+            fn(elem.first, elem.second);
+          }
+        }
+      });
+    }
+    for (auto &w : workers) {
+      w.join();
+    }
+  }
+
+  size_t size() const {
+    size_t total = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+      std::shared_lock lk(shards_[i].m);
+      total += shards_[i].map.size();
+    }
+    return total;
+  }
+
+private:
+  // 用哈希值的高位选择分片，低位留给分片内部的 unordered_map 选择桶，
+  // 避免同一个分片中的键都落在少数几个桶里。
+  size_t shard_index(const K &key) const {
+    size_t h = Hash{}(key) * 0x9E3779B97F4A7C15ULL;
+    return (h >> 40) & mask_;
+  }
+  Shard &shard_for(const K &key) { return shards_[shard_index(key)]; }
+  const Shard &shard_for(const K &key) const { return shards_[shard_index(key)]; }
+
+  size_t mask_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// 混合负载基准测试：每个线程执行 ops_per_thread 次操作，
+// 其中 read_percent% 是 find，其余是 insert_or_assign。返回吞吐量（百万次操作/秒）。
+double run_mixed(ShardedHashMap<int, int> &map, int threads, int ops_per_thread,
+                 int read_percent, int key_range) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      uint64_t state = 88172645463325252ULL + t;
+      for (int i = 0; i < ops_per_thread; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int key = static_cast<int>(state % key_range);
+        if (static_cast<int>((state >> 32) % 100) < read_percent) {
+          map.find(key);
+        } else {
+          map.insert_or_assign(key, i);
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+int main() {
+  // 首先，我们像 unordered_maps.cpp 一样使用这个 map。
+  ShardedHashMap<std::string, int> map;
+  map.insert_or_assign("foo", 2);
+  map.insert_or_assign("jignesh", 445);
+  map.insert_or_assign("spam", 1);
+  map.insert_or_assign("eggs", 2);
+  map.insert_or_assign("spam", 15);
+
+  if (auto result = map.find("jignesh")) {
+    std::cout << "Found key jignesh with value " << *result << std::endl;
+  }
+  map.erase("eggs");
+  if (!map.find("eggs")) {
+    std::cout << "Key-value pair with key eggs does not exist in the map.\n";
+  }
+
+  // 四个线程同时用 compute 给同一组计数器加一。最终每个计数器都应该等于 4 * 1000。
+  ShardedHashMap<int, int> counters;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&counters]() {
+      for (int round = 0; round < 1000; ++round) {
+        for (int key = 0; key < 10; ++key) {
+          counters.compute(key, [](const int *old) { return std::optional<int>(old ? *old + 1 : 1); });
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::cout << "Printing counters with for_each:\n";
+  counters.for_each([](int key, int value) { std::cout << "(" << key << ", " << value << "), "; });
+  std::cout << "\n";
+
+  // 最后比较吞吐量：64 个分片对比只有 1 个分片（相当于一把全局锁）。
+  // 注意：在核数很少的机器上，线程数超过核数之后吞吐量不会继续增长。
+  const int ops_per_thread = 200000;
+  const int key_range = 1 << 16;
+  std::cout << "threads  read%  sharded(Mops/s)  global_lock(Mops/s)\n";
+  for (int read_percent : {100, 90, 50}) {
+    for (int thread_count : {1, 2, 4, 8}) {
+      ShardedHashMap<int, int> sharded(64);
+      ShardedHashMap<int, int> global(1);
+      for (int k = 0; k < key_range; ++k) {
+        sharded.insert_or_assign(k, k);
+        global.insert_or_assign(k, k);
+      }
+      double a = run_mixed(sharded, thread_count, ops_per_thread, read_percent, key_range);
+      double b = run_mixed(global, thread_count, ops_per_thread, read_percent, key_range);
+      std::cout << thread_count << "        " << read_percent << "    " << a << "          "
+                << b << "\n";
+    }
+  }
+
+  return 0;
+}
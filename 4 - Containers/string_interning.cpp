@@ -0,0 +1,363 @@
+// 在 unordered_maps.cpp 中，std::unordered_map<std::string, int> 的每个键都是一个 std::string。
+// 超过 SSO 缓冲区长度的 std::string 会拥有自己单独的一块堆内存，
+// 所以当有几百万个键时，内存中散布着几百万个小块，既浪费（每块都有分配器的额外开销），
+// 又会让查找变慢：每次比较键都要跟随指针，逐字节比较字符串。
+
+// 字符串驻留（string interning）的思路是：每个不同的字符串只保存一份，
+// 并给它分配一个紧凑的整数编号（称为符号，symbol）。
+// 之后程序中到处传递和存储的都是 32 位的符号，而不是字符串本身：
+//   - 两个符号相等当且仅当它们代表的字符串相等，比较只需要一次整数比较；
+//   - 以符号为键的哈希表只需要对一个整数求哈希。
+// 所有字符串的字节被连续地存放在一个"竞技场"（arena）分配器中，
+// 它每次向系统申请一大块内存，然后在其中顺序地放置字符串，从不单独释放。
+// 驻留器本身每个编号只多用 8 个字节：字符串在 arena 中的 32 位句柄和 32 位哈希值。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::malloc、std::free。
+#include <cstdlib>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::hash。
+#include <functional>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::bad_alloc。
+#include <new>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::length_error。
+#include <stdexcept>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 unordered_map 容器库头文件，作为基准测试的对照组。
+#include <unordered_map>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含 FlatHashMap 的实现，SymbolMap 用它存放元素。
+#include "flat_hash_map.h"
+
+// 为了比较内存占用，我们替换全局的 operator new 和 operator delete，
+// 在每块内存前面记录它的大小，从而统计当前仍在使用的堆内存字节数和块数。
+// 注意：每个块在分配器内部还有额外的簿记开销，这里没有计入，所以块数越多，真实占用越大。
+static size_t live_bytes = 0;
+static size_t live_blocks = 0;
+
+void *operator new(size_t size) {
+  void *raw = std::malloc(size + 16);
+  if (raw == nullptr) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t *>(raw) = size;
+  live_bytes += size;
+  ++live_blocks;
+  return static_cast<char *>(raw) + 16;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  void *raw = static_cast<char *>(ptr) - 16;
+  live_bytes -= *static_cast<size_t *>(raw);
+  --live_blocks;
+  std::free(raw);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+// Arena 是一个只增不减的字节分配器。
+// 它按 64KB 的块申请内存，字符串被顺序地拷贝进当前块，前面是 4 个字节的长度；
+// 比一个块还长的字符串单独占用一个块。
+// add 返回一个 32 位的句柄：块的编号乘以 kBlockSize，再加上字符串在块中的位置。
+// 句柄只有 4 个字节，而一个 std::string_view 要 16 个字节。
+// 已经放入的字符串永远不会被移动，所以句柄和 get 返回的 std::string_view 一直有效。
+class Arena {
+  static constexpr size_t kBlockSize = 64 * 1024;
+  // 句柄是 32 位的，所以最多只能有 2^32 / kBlockSize 个块。
+  static constexpr size_t kMaxBlocks = (uint64_t{1} << 32) / kBlockSize;
+
+public:
+  Arena() = default;
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  uint32_t add(std::string_view str) {
+    if (str.size() > UINT32_MAX) {
+      throw std::length_error("string is too long for the arena");
+    }
+    size_t needed = sizeof(uint32_t) + str.size();
+    if (needed > remaining_) {
+      if (blocks_.size() == kMaxBlocks) {
+        throw std::length_error("arena is full");
+      }
+      size_t size = needed > kBlockSize ? needed : kBlockSize;
+      blocks_.emplace_back(new char[size]);
+      used_ = 0;
+      remaining_ = size;
+    }
+    char *dest = blocks_.back().get() + used_;
+    uint32_t length = static_cast<uint32_t>(str.size());
+    std::memcpy(dest, &length, sizeof(length));
+    std::memcpy(dest + sizeof(length), str.data(), str.size());
+    uint32_t handle = static_cast<uint32_t>((blocks_.size() - 1) * kBlockSize + used_);
+    used_ += needed;
+    remaining_ -= needed;
+    return handle;
+  }
+
+  std::string_view get(uint32_t handle) const {
+    const char *pos = blocks_[handle / kBlockSize].get() + handle % kBlockSize;
+    uint32_t length;
+    std::memcpy(&length, pos, sizeof(length));
+    return std::string_view(pos + sizeof(length), length);
+  }
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t used_ = 0;
+  size_t remaining_ = 0;
+};
+
+// Symbol 是一个被驻留的字符串的编号。它只有 4 个字节，可以像整数一样拷贝和比较。
+struct Symbol {
+  uint32_t id;
+
+  bool operator==(Symbol other) const { return id == other.id; }
+  bool operator!=(Symbol other) const { return id != other.id; }
+};
+
+// 为 Symbol 特化 std::hash，这样它就可以直接作为 std::unordered_map 的键。
+namespace std {
+template <> struct hash<Symbol> {
+  size_t operator()(Symbol symbol) const { return std::hash<uint32_t>{}(symbol.id); }
+};
+} // namespace std
+
+// StringInterner 把字符串映射为 Symbol，并可以把 Symbol 映射回字符串。
+// 字符串的字节存放在 Arena 中；编号到字符串的映射是一个保存 Arena 句柄的 std::vector<uint32_t>；
+// 字符串到编号的映射是一个开放寻址的哈希表，表中只存放 32 位编号，
+// 探测时通过编号找到对应的字符串来比较。
+class StringInterner {
+  // 编号 kEmpty 在哈希表中表示空槽位，所以它不能被分配给任何字符串。
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+
+public:
+  StringInterner() : table_(16, kEmpty) {}
+
+  // 为 count 个不同的字符串预先分配空间：哈希表扩大到负载不超过 3/4，两个编号数组恰好放得下 count 个编号。
+  void reserve(size_t count) {
+    size_t size = table_.size();
+    while (count * 4 > size * 3) {
+      size *= 2;
+    }
+    if (size != table_.size()) {
+      rehash(size);
+    }
+    handles_.reserve(count);
+    hashes_.reserve(count);
+  }
+
+  // 返回 str 的符号。如果 str 是第一次出现，就把它拷贝进 arena 并分配一个新编号。
+  Symbol intern(std::string_view str) {
+    uint32_t hash = hash_of(str);
+    size_t index = probe(str, hash);
+    if (table_[index] != kEmpty) {
+      return Symbol{table_[index]};
+    }
+    if (handles_.size() == kEmpty) {
+      throw std::length_error("too many interned strings");
+    }
+    // 插入之前保证负载不超过 3/4。两个编号数组的容量和哈希表一起增长，
+    // 所以它们不会各自按两倍增长，也不会在下面的 push_back 中重新分配（从而两者总是一样长）。
+    if ((handles_.size() + 1) * 4 > table_.size() * 3) {
+      rehash(table_.size() * 2);
+      index = probe(str, hash);
+    }
+    if (handles_.size() == handles_.capacity()) {
+      handles_.reserve(table_.size() / 4 * 3);
+      hashes_.reserve(table_.size() / 4 * 3);
+    }
+    uint32_t id = static_cast<uint32_t>(handles_.size());
+    handles_.push_back(arena_.add(str));
+    hashes_.push_back(hash);
+    table_[index] = id;
+    return Symbol{id};
+  }
+
+  // 只查找、不插入。如果 str 从未被驻留过，返回 std::nullopt。
+  std::optional<Symbol> lookup(std::string_view str) const {
+    size_t index = probe(str, hash_of(str));
+    if (table_[index] == kEmpty) {
+      return std::nullopt;
+    }
+    return Symbol{table_[index]};
+  }
+
+  std::string_view str(Symbol symbol) const { return arena_.get(handles_[symbol.id]); }
+
+  size_t size() const { return handles_.size(); }
+
+private:
+  // 只保存 32 位的哈希值就足够用来确定槽位和快速排除不相等的字符串。
+  static uint32_t hash_of(std::string_view str) {
+    return static_cast<uint32_t>(std::hash<std::string_view>{}(str));
+  }
+
+  // 线性探测，返回 str 所在的槽位，或者它应该被插入的空槽位。
+  size_t probe(std::string_view str, uint32_t hash) const {
+    size_t mask = table_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+      uint32_t id = table_[index];
+      if (id == kEmpty || (hashes_[id] == hash && arena_.get(handles_[id]) == str)) {
+        return index;
+      }
+    }
+  }
+
+  // 扩容时不需要重新计算字符串的哈希值，它们已经保存在 hashes_ 中。
+  void rehash(size_t size) {
+    std::vector<uint32_t> table(size, kEmpty);
+    size_t mask = table.size() - 1;
+    for (uint32_t id = 0; id < handles_.size(); ++id) {
+      size_t index = hashes_[id] & mask;
+      while (table[index] != kEmpty) {
+        index = (index + 1) & mask;
+      }
+      table[index] = id;
+    }
+    table_ = std::move(table);
+  }
+
+  Arena arena_;
+  std::vector<uint32_t> handles_;
+  std::vector<uint32_t> hashes_;
+  std::vector<uint32_t> table_;
+};
+
+// SymbolMap 是以符号为键的扁平哈希表（见 flat_hash_map.h）：元素直接存放在槽位数组中，
+// 每个元素只占一个 4 字节的符号和一个值，不需要像 std::unordered_map 那样为每个元素分配一个节点；
+// 求哈希和比较键也都只是整数运算。
+template <typename V> using SymbolMap = FlatHashMap<Symbol, V>;
+
+int main() {
+  // 首先看一个小例子。相同的字符串总是得到相同的符号。
+  StringInterner interner;
+  Symbol andy = interner.intern("andy");
+  Symbol jignesh = interner.intern("jignesh");
+  Symbol andy_again = interner.intern(std::string("an") + "dy");
+  std::cout << "andy -> " << andy.id << ", jignesh -> " << jignesh.id
+            << ", andy again -> " << andy_again.id << "\n";
+  if (andy == andy_again) {
+    std::cout << "Both symbols refer to the string " << interner.str(andy) << "\n";
+  }
+  if (!interner.lookup("spam")) {
+    std::cout << "spam has never been interned.\n";
+  }
+
+  SymbolMap<int> map;
+  map.insert({andy, 445});
+  map.insert({jignesh, 645});
+  for (const auto &elem : map) {
+    std::cout << "(" << interner.str(elem.first) << "," << elem.second << ") ";
+  }
+  std::cout << "\n";
+
+  // 接下来是基准测试：一个由 2,000,000 个词组成的流，其中只有 200,000 个不同的词，
+  // 每个词都比 SSO 缓冲区更长。我们统计每个词出现的次数。
+  const size_t unique = 200000;
+  const size_t stream_length = 2000000;
+  std::vector<std::string> words;
+  for (size_t i = 0; i < unique; ++i) {
+    words.push_back("customer-account-identifier-" + std::to_string(i * 7919));
+  }
+  // 流中每个词至少出现一次，其余位置随机选词。
+  std::vector<uint32_t> stream;
+  for (size_t i = 0; i < unique; ++i) {
+    stream.push_back(static_cast<uint32_t>(i));
+  }
+  uint64_t state = 12345;
+  for (size_t i = unique; i < stream_length; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    stream.push_back(static_cast<uint32_t>((state >> 33) % unique));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  long long sum = 0;
+
+  // 两种方式都预先知道不同的词有多少个，所以都先 reserve。
+  // 以 std::string 为键。
+  {
+    size_t before = live_bytes;
+    size_t before_blocks = live_blocks;
+    std::unordered_map<std::string, int> counts;
+    counts.reserve(unique);
+    for (uint32_t w : stream) {
+      ++counts[words[w]];
+    }
+    size_t footprint = live_bytes - before;
+    size_t blocks = live_blocks - before_blocks;
+    auto start = Clock::now();
+    for (int round = 0; round < 10; ++round) {
+      for (const auto &word : words) {
+        sum += counts.find(word)->second;
+      }
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    std::cout << "std::string keys: " << footprint / 1024 << " KiB in " << blocks
+              << " blocks, lookup "
+              << elapsed.count() / (10.0 * unique) << " ns\n";
+  }
+
+  // 以符号为键。符号通常在数据进入系统时就被驻留一次，
+  // 之后程序内部的所有查找都使用符号，所以这里测量的是按符号查找的代价。
+  {
+    size_t before = live_bytes;
+    size_t before_blocks = live_blocks;
+    StringInterner words_interner;
+    words_interner.reserve(unique);
+    SymbolMap<int> counts;
+    std::vector<Symbol> symbols;
+    for (const auto &word : words) {
+      symbols.push_back(words_interner.intern(word));
+    }
+    size_t symbols_bytes = symbols.capacity() * sizeof(Symbol);
+    for (uint32_t w : stream) {
+      ++counts[symbols[w]];
+    }
+    size_t footprint = live_bytes - before - symbols_bytes;
+    size_t blocks = live_blocks - before_blocks - 1;
+    auto start = Clock::now();
+    for (int round = 0; round < 10; ++round) {
+      for (Symbol symbol : symbols) {
+        sum += counts.find(symbol)->second;
+      }
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    std::cout << "Symbol keys:      " << footprint / 1024 << " KiB in " << blocks
+              << " blocks (interner + map), lookup " << elapsed.count() / (10.0 * unique)
+              << " ns\n";
+
+    // 如果查找时手上只有字符串，就需要先经过驻留器得到符号，这一步仍要对字符串求哈希一次。
+    start = Clock::now();
+    for (int round = 0; round < 10; ++round) {
+      for (const auto &word : words) {
+        sum += counts.find(*words_interner.lookup(word))->second;
+      }
+    }
+    elapsed = Clock::now() - start;
+    std::cout << "Symbol keys via string lookup: " << elapsed.count() / (10.0 * unique)
+              << " ns\n";
+  }
+  std::cout << "Checksum: " << sum << "\n";
+
+  return 0;
+}
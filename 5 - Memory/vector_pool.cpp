@@ -0,0 +1,245 @@
+// move_semantics.cpp 中的 move_add_three_and_print 接受一个 std::vector<int> &&，
+// 把它移动到局部变量 vec1 中，追加一个元素，函数返回时 vec1 被销毁，它的缓冲区也被释放。
+// 移动本身很便宜，但如果这种"创建 vector、传递下去、用完即弃"的模式每秒发生几百万次，
+// 每次都要向分配器申请一块内存、再还回去，分配器的开销就会成为主要成本。
+
+// 这个文件实现一个线程局部（thread_local）的 vector 缓冲区池 VectorPool<T>：
+//   - 用完的 vector 不释放，而是清空元素（保留容量）后放回池中；
+//   - 池按容量分级：第 k 级存放容量在 [2^k, 2^(k+1)) 之间的 vector；
+//   - 申请一个至少能容纳 n 个元素的 vector 时，从能满足要求的最小一级中取出一个，
+//     池中没有合适的 vector 时才真正分配。
+// 每个线程有自己的池，所以取出和放回都不需要加锁。
+// PooledVector<T> 是一个 RAII 句柄（类似 std::unique_ptr），它在离开作用域时自动把缓冲区还给池。
+
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::malloc、std::free。
+#include <cstdlib>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::bad_alloc。
+#include <new>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 为了在基准测试中统计堆分配的次数，我们替换全局的 operator new 和 operator delete。
+// 每次调用 operator new 都会让 allocation_count 加一。
+static size_t allocation_count = 0;
+
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+template <typename T> class VectorPool {
+  // 容量分级的个数（最大一级的容量是 2^31 个元素），以及每一级最多保留的 vector 个数。
+  // 超过上限的 vector 会被直接释放，防止一次突发的大量申请让池永久占用很多内存。
+  static constexpr size_t kClasses = 32;
+  static constexpr size_t kMaxPerClass = 64;
+
+public:
+  struct Stats {
+    size_t reused = 0;
+    size_t allocated = 0;
+    size_t dropped = 0;
+  };
+
+  // 当前线程的池。第一次调用时构造，线程结束时析构并释放池中所有的缓冲区。
+  static VectorPool &local() {
+    thread_local VectorPool pool;
+    return pool;
+  }
+
+  // 取出一个空的、容量至少为 min_capacity 的 vector。
+  std::vector<T> acquire(size_t min_capacity) {
+    size_t cls = ceil_log2(min_capacity);
+    for (size_t k = cls; k < kClasses; ++k) {
+      auto &free_list = free_[k];
+      if (!free_list.empty()) {
+        std::vector<T> vec = std::move(free_list.back());
+        free_list.pop_back();
+        ++stats_.reused;
+        return vec;
+      }
+    }
+    ++stats_.allocated;
+    std::vector<T> vec;
+    vec.reserve(size_t(1) << cls);
+    return vec;
+  }
+
+  // 把一个 vector 放回池中。它的元素会被清空，但缓冲区（容量）被保留下来。
+  void release(std::vector<T> &&vec) {
+    if (vec.capacity() == 0) {
+      return;
+    }
+    vec.clear();
+    auto &free_list = free_[floor_log2(vec.capacity())];
+    if (free_list.size() >= kMaxPerClass) {
+      ++stats_.dropped;
+      // vec 只是调用者那个 vector 的右值引用，直接返回不会释放任何东西；
+      // 把它移动到一个局部变量中，缓冲区才会在这里随 dropped 一起被释放。
+      std::vector<T> dropped = std::move(vec);
+      return;
+    }
+    free_list.push_back(std::move(vec));
+  }
+
+  const Stats &stats() const { return stats_; }
+
+private:
+  VectorPool() {
+    // 预先为每一级的空闲列表分配好空间，这样放回 vector 时不会再触发分配。
+    for (auto &free_list : free_) {
+      free_list.reserve(kMaxPerClass);
+    }
+  }
+
+  static size_t floor_log2(size_t n) {
+    size_t k = 0;
+    while ((n >> (k + 1)) != 0) {
+      ++k;
+    }
+    return k < kClasses ? k : kClasses - 1;
+  }
+
+  static size_t ceil_log2(size_t n) {
+    size_t k = 0;
+    while ((size_t(1) << k) < n) {
+      ++k;
+    }
+    return k;
+  }
+
+  std::vector<std::vector<T>> free_[kClasses];
+  Stats stats_;
+};
+
+// 从当前线程的池中借来的 vector。和 std::unique_ptr 一样只能移动，不能拷贝；
+// 析构时把缓冲区还给当前线程的池（如果它已经被移走，就什么也不做）。
+// 注意：不要让 PooledVector 活得比创建它的线程更久，否则它会被还给另一个线程的池。
+template <typename T> class PooledVector {
+public:
+  explicit PooledVector(size_t min_capacity = 0)
+      : vec_(VectorPool<T>::local().acquire(min_capacity)) {}
+
+  ~PooledVector() { VectorPool<T>::local().release(std::move(vec_)); }
+
+  // std::vector 的移动会把缓冲区整个交给新对象，other 剩下一个没有缓冲区的 vector，
+  // 所以 other 析构时不会把任何东西放回池中。
+  PooledVector(PooledVector &&other) noexcept : vec_(std::move(other.vec_)) {}
+  PooledVector &operator=(PooledVector &&other) noexcept {
+    if (this != &other) {
+      VectorPool<T>::local().release(std::move(vec_));
+      vec_ = std::move(other.vec_);
+    }
+    return *this;
+  }
+
+  PooledVector(const PooledVector &) = delete;
+  PooledVector &operator=(const PooledVector &) = delete;
+
+  std::vector<T> &operator*() { return vec_; }
+  std::vector<T> *operator->() { return &vec_; }
+
+  // 把 vector 从池的管理中取出来，调用者拥有它，它不会再被放回池中。
+  std::vector<T> detach() { return std::move(vec_); }
+
+private:
+  std::vector<T> vec_;
+};
+
+// 与 move_semantics.cpp 中的 move_add_three_and_print 相同，只是参数换成了 PooledVector。
+// 函数返回时 vec1 被销毁，缓冲区回到池中，而不是被释放。
+void move_add_three_and_print(PooledVector<int> &&vec) {
+  PooledVector<int> vec1 = std::move(vec);
+  vec1->push_back(3);
+  for (const int &item : *vec1) {
+    std::cout << item << " ";
+  }
+  std::cout << "\n";
+}
+
+// 基准测试中流水线的一级：接管 vector，追加一个元素，求和。不打印。
+long long consume(std::vector<int> &&vec) {
+  std::vector<int> vec1 = std::move(vec);
+  vec1.push_back(3);
+  long long sum = 0;
+  for (int item : vec1) {
+    sum += item;
+  }
+  return sum;
+}
+
+long long consume(PooledVector<int> &&vec) {
+  PooledVector<int> vec1 = std::move(vec);
+  vec1->push_back(3);
+  long long sum = 0;
+  for (int item : *vec1) {
+    sum += item;
+  }
+  return sum;
+}
+
+int main() {
+  // 首先，我们像 move_semantics.cpp 中那样调用 move_add_three_and_print，
+  // 不过 vector 是从池中借来的。第二次调用时，缓冲区来自第一次调用归还的那一个。
+  for (int round = 0; round < 2; ++round) {
+    PooledVector<int> int_array2(4);
+    *int_array2 = {1, 2, 3, 4};
+    std::cout << "Calling move_add_three_and_print...\n";
+    move_add_three_and_print(std::move(int_array2));
+  }
+  const auto &stats = VectorPool<int>::local().stats();
+  std::cout << "Pool stats: reused " << stats.reused << ", allocated " << stats.allocated << "\n";
+
+  // 基准测试：n 次"创建一个有 size 个元素的 vector，移动给下一级，用完即弃"，
+  // size 在 8 到 1024 之间变化。比较每次都分配新 vector 和从池中借用两种方式的速度和分配次数。
+  // 注意：glibc 的 malloc 对刚释放的小块有线程局部缓存（tcache），在这种"分配后马上释放"的
+  // 单线程循环中本身已经很快，所以两者的耗时可能接近；池的优势主要体现在分配次数上，
+  // 以及分配器压力更大（多线程、碎片化、较大的缓冲区）的场景中。
+  const size_t n = 1000000;
+  std::vector<size_t> sizes;
+  for (size_t i = 0; i < n; ++i) {
+    sizes.push_back(size_t(8) << (i * 5 % 8));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  long long checksum = 0;
+
+  size_t before = allocation_count;
+  auto start = Clock::now();
+  for (size_t size : sizes) {
+    std::vector<int> vec;
+    vec.reserve(size + 1);
+    vec.assign(size, 1);
+    checksum += consume(std::move(vec));
+  }
+  std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+  std::cout << "std::vector:  " << elapsed.count() << " ms, "
+            << n / elapsed.count() / 1000.0 << " M vectors/s, " << allocation_count - before
+            << " allocations\n";
+
+  before = allocation_count;
+  start = Clock::now();
+  for (size_t size : sizes) {
+    PooledVector<int> vec(size + 1);
+    vec->assign(size, 1);
+    checksum += consume(std::move(vec));
+  }
+  elapsed = Clock::now() - start;
+  std::cout << "PooledVector: " << elapsed.count() << " ms, "
+            << n / elapsed.count() / 1000.0 << " M vectors/s, " << allocation_count - before
+            << " allocations\n";
+  std::cout << "Checksum: " << checksum << "\n";
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+// rwlock.cpp 中的读者用 std::shared_lock 保护对 count 的读取，写者用 std::unique_lock 修改它。
+// 如果被保护的不是一个 int，而是一个较大的、经常被读取的结构（例如一份配置），
+// 还有另一种常见的做法：把数据放在一个不可变的节点中，通过 std::atomic<Node *> 发布。
+// 读者不加锁，直接读取当前节点；写者创建一个新节点，用原子交换换上去。
+// 难点在于旧节点什么时候可以释放——也许还有读者正拿着它的指针。
+
+// epoch_reclamation.h 实现了基于纪元的回收（EBR）来解决这个问题。这个文件：
+//   1. 用它改写 rwlock.cpp 的例子；
+//   2. 运行压力测试：多个读者和写者同时运行，读者检查读到的节点是否完整、是否已被释放，
+//      最后检查所有节点都被释放了恰好一次；
+//   3. 比较读者的开销：EBR 的 Guard 对比 std::shared_lock。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t 等定长整数类型。
+#include <cstdint>
+// 包含std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含shared mutex库头文件。
+#include <shared_mutex>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 包含本目录中的 EBR 实现。
+#include "epoch_reclamation.h"
+
+// 读者看到的不可变节点。value 和 doubled 总是一起写入，读者用它们检查节点是否完整。
+// 析构时把 alive 清零：如果读者读到 alive 为 0，说明节点在它还在使用时被释放了。
+struct Node {
+  static constexpr uint32_t kAlive = 0xA11CE;
+
+  explicit Node(long long v) : value(v), doubled(2 * v) { created.fetch_add(1); }
+  ~Node() {
+    alive = 0;
+    destroyed.fetch_add(1);
+  }
+
+  long long value;
+  long long doubled;
+  uint32_t alive = kAlive;
+
+  static std::atomic<long long> created;
+  static std::atomic<long long> destroyed;
+};
+
+std::atomic<long long> Node::created{0};
+std::atomic<long long> Node::destroyed{0};
+
+// 与 rwlock.cpp 中相同的 read_value 和 write_value，只是 count 放在一个通过原子指针发布的节点中。
+ebr::Domain domain;
+std::atomic<Node *> count{new Node(0)};
+
+void read_value() {
+  ebr::Registration reg(domain);
+  ebr::Guard guard(reg);
+  Node *node = count.load(std::memory_order_acquire);
+  std::cout << "Reading value " + std::to_string(node->value) + "\n" << std::flush;
+}
+
+// 两个写者可能同时执行，所以用比较交换（compare_exchange）重试，而不是直接交换。
+void write_value() {
+  ebr::Registration reg(domain);
+  ebr::Guard guard(reg);
+  Node *old_node = count.load(std::memory_order_acquire);
+  Node *new_node = new Node(old_node->value + 3);
+  while (!count.compare_exchange_weak(old_node, new_node)) {
+    delete new_node;
+    new_node = new Node(old_node->value + 3);
+  }
+  reg.retire(old_node);
+}
+
+// 压力测试：readers 个读者和 writers 个写者同时运行 duration 时间。
+// 返回发现的错误个数：读者读到不完整或已释放的节点，以及没有被释放恰好一次的节点。
+long long stress(int readers, int writers, std::chrono::milliseconds duration) {
+  long long alive_before = Node::created - Node::destroyed;
+  std::atomic<long long> errors{0};
+  std::atomic<long long> reads{0};
+  {
+    ebr::Domain stress_domain;
+    std::atomic<Node *> shared{new Node(1)};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+      threads.emplace_back([&]() {
+        ebr::Registration reg(stress_domain);
+        long long bad = 0;
+        long long n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          ebr::Guard guard(reg);
+          Node *node = shared.load(std::memory_order_acquire);
+          // 在临界区中多读几次，给写者替换和释放节点的机会。
+          for (int i = 0; i < 4; ++i) {
+            bad += node->alive != Node::kAlive || node->doubled != 2 * node->value;
+          }
+          ++n;
+        }
+        errors += bad;
+        reads += n;
+      });
+    }
+    for (int t = 0; t < writers; ++t) {
+      // 每个写者用自己的 Registration，线程结束时注销；没来得及释放的节点交给 Domain。
+      threads.emplace_back([&, t]() {
+        ebr::Registration reg(stress_domain);
+        for (long long i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+          Node *old_node = shared.exchange(new Node(i * writers + t));
+          reg.retire(old_node);
+        }
+      });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &t : threads) {
+      t.join();
+    }
+    delete shared.load();
+    // stress_domain 在这里被销毁，释放剩下的所有节点。
+  }
+  // 这时这次测试创建的节点都应该被释放了恰好一次：少释放是泄漏，多释放是重复释放。
+  long long unbalanced = Node::created - Node::destroyed - alive_before;
+  std::cout << "  " << readers << " readers, " << writers << " writers: " << reads.load()
+            << " reads, " << errors.load() << " errors, " << unbalanced
+            << " nodes not freed exactly once\n";
+  return errors.load() + (unbalanced < 0 ? -unbalanced : unbalanced);
+}
+
+// 读者开销：threads 个读者各读 ops_per_thread 次。返回吞吐量（百万次操作/秒）。
+double read_with_guard(int threads, int ops_per_thread) {
+  ebr::Domain bench_domain;
+  std::atomic<Node *> shared{new Node(7)};
+  std::atomic<long long> sink{0};
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&]() {
+      ebr::Registration reg(bench_domain);
+      long long sum = 0;
+      for (int i = 0; i < ops_per_thread; ++i) {
+        ebr::Guard guard(reg);
+        sum += shared.load(std::memory_order_acquire)->value;
+      }
+      sink += sum;
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  delete shared.load();
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+double read_with_shared_lock(int threads, int ops_per_thread) {
+  std::shared_mutex m;
+  long long value = 7;
+  std::atomic<long long> sink{0};
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&]() {
+      long long sum = 0;
+      for (int i = 0; i < ops_per_thread; ++i) {
+        std::shared_lock lk(m);
+        sum += value;
+      }
+      sink += sum;
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+int main() {
+  // 首先，我们像 rwlock.cpp 中那样运行两个写者和四个读者。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 压力测试。
+  std::cout << "Stress tests:\n";
+  long long errors = 0;
+  errors += stress(4, 1, std::chrono::milliseconds(300));
+  errors += stress(2, 2, std::chrono::milliseconds(300));
+  errors += stress(8, 4, std::chrono::milliseconds(300));
+  std::cout << "Errors: " << errors << "\n";
+
+  // 基准测试：读者的开销。
+  // 注意：在核数很少的机器上，读者不能真正并行执行，看不到 std::shared_mutex 读者计数器的争用，
+  // 需要在多核机器上运行才能看到读者数增加时两者的差距。
+  const int ops_per_thread = 1000000;
+  std::cout << "readers  std::shared_lock(Mops/s)  ebr::Guard(Mops/s)\n";
+  for (int threads : {1, 2, 4, 8}) {
+    double a = read_with_shared_lock(threads, ops_per_thread);
+    double b = read_with_guard(threads, ops_per_thread);
+    std::cout << threads << "        " << a << "                 " << b << "\n";
+  }
+
+  // 最后释放 count 中的当前节点，并让 domain 释放已注销的写者留下的旧节点：
+  // 没有线程在临界区中，每次 collect 都能推进一个纪元，两次之后它们都可以安全释放。
+  delete count.load();
+  {
+    ebr::Registration reg(domain);
+    reg.collect();
+    reg.collect();
+  }
+  // 所有节点都应该被释放了恰好一次。
+  long long unbalanced = Node::created - Node::destroyed;
+  std::cout << "Nodes created: " << Node::created << ", destroyed: " << Node::destroyed << "\n";
+  return errors == 0 && unbalanced == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+// 这个头文件实现基于纪元的内存回收（epoch-based reclamation，EBR），供无锁的读者使用。
+// 它被 epoch_reclamation.cpp 和 4 - Containers/concurrent_skip_list.cpp 使用，
+// 也可以被任何需要"读者不加锁、写者替换后延迟释放"的代码使用。
+
+// 问题是这样的：在 rwlock.cpp 中，读者持有读锁时，写者不能修改数据，所以写者释放旧数据时
+// 不会有读者还在使用它。如果读者不加锁（例如通过一个 std::atomic<Node *> 读取当前的节点），
+// 写者换上新节点之后，就无法知道是否还有读者正拿着旧节点的指针，也就不能立即 delete 它。
+
+// EBR 的思路是：
+//   - 有一个全局纪元（epoch）计数器。每个线程在读取共享数据之前"进入临界区"，
+//     把当前的全局纪元记录在自己的槽里；读完之后"离开临界区"，清除这个记录；
+//   - 写者把节点从数据结构中摘下来之后，不立即释放它，而是调用 retire，
+//     把它和当时的全局纪元 e 一起放进自己的"待释放"列表；
+//   - 只有当所有处于临界区中的线程都已经看到了当前纪元 e 时，全局纪元才能前进到 e + 1。
+//     全局纪元前进到 e + 2 时，在纪元 e 或更早进入临界区的读者都已经离开了，
+//     所以在纪元 e 被 retire 的节点不可能再被任何读者访问，可以安全地释放。
+// 读者的开销只是两次对自己的缓存行的写入（进入和离开），不会和其他线程争抢缓存行。
+
+// 用法：
+//   ebr::Domain domain;                       // 通常每个数据结构（或整个程序）一个
+//   ebr::Registration reg(domain);            // 每个线程注册一次（RAII，析构时注销）
+//   {
+//     ebr::Guard guard(reg);                  // 读者：在 guard 的生存期内读取的节点不会被释放
+//     Node *node = shared.load(std::memory_order_acquire);
+//     ...
+//   }
+//   Node *old = shared.exchange(new_node);    // 写者：摘下旧节点
+//   reg.retire(old);                          // 等到安全时再 delete
+// retire 每调用若干次，就会尝试推进全局纪元并释放本线程列表中已经安全的节点（摊销回收），
+// 不需要单独的后台线程。
+
+#pragma once
+
+// 包含 std::atomic、std::atomic_thread_fence。
+#include <atomic>
+// 包含 uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::deque。
+#include <deque>
+// 包含 std::mutex、std::scoped_lock、std::unique_lock。
+#include <mutex>
+
+namespace ebr {
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+// 一个等待释放的对象：指针、释放它的函数，以及它被 retire 时的全局纪元。
+struct Retired {
+  void *ptr;
+  void (*deleter)(void *);
+  uint64_t epoch;
+};
+
+// 每个注册的线程在 Domain 中有一个 Participant。它独占一个缓存行，只有它的线程会写入它。
+struct alignas(kCacheLineSize) Participant {
+  // 不在临界区时为 0；在临界区中时为 (进入时的全局纪元 << 1) | 1。
+  std::atomic<uint64_t> state{0};
+  // 当前正在使用这个 Participant 的线程（线程注销后可以被新线程重用）。
+  std::atomic<bool> in_use{false};
+  // 以下成员只被拥有它的线程访问。
+  int nesting = 0;
+  size_t retires_since_collect = 0;
+  std::deque<Retired> retired;
+  Participant *next = nullptr;
+};
+
+class Domain {
+public:
+  // 每 kCollectInterval 次 retire 尝试一次回收。
+  static constexpr size_t kCollectInterval = 64;
+
+  Domain() = default;
+  Domain(const Domain &) = delete;
+  Domain &operator=(const Domain &) = delete;
+
+  // 销毁 Domain 时，所有线程都必须已经注销，所以剩下的对象都可以直接释放。
+  ~Domain() {
+    for (auto &r : orphans_) {
+      r.deleter(r.ptr);
+    }
+    Participant *p = head_.load(std::memory_order_acquire);
+    while (p != nullptr) {
+      Participant *next = p->next;
+      delete p;
+      p = next;
+    }
+  }
+
+  uint64_t epoch() const { return epoch_.load(std::memory_order_seq_cst); }
+
+  // 如果所有处于临界区中的线程都已经看到了当前纪元，就把全局纪元加一。返回是否前进了。
+  bool try_advance() {
+    uint64_t current = epoch_.load(std::memory_order_seq_cst);
+    for (Participant *p = head_.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+      uint64_t state = p->state.load(std::memory_order_seq_cst);
+      if ((state & 1) && (state >> 1) != current) {
+        return false;
+      }
+    }
+    return epoch_.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+  }
+
+private:
+  friend class Registration;
+  friend class Guard;
+
+  // 取得一个空闲的 Participant，没有就新建一个并挂到链表头部。Participant 永远不会从链表中删除，
+  // 所以 try_advance 可以不加锁地遍历链表。
+  Participant *acquire_participant() {
+    for (Participant *p = head_.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+      bool expected = false;
+      if (!p->in_use.load(std::memory_order_relaxed) &&
+          p->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        return p;
+      }
+    }
+    auto *p = new Participant;
+    p->in_use.store(true, std::memory_order_relaxed);
+    Participant *head = head_.load(std::memory_order_relaxed);
+    do {
+      p->next = head;
+    } while (!head_.compare_exchange_weak(head, p, std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return p;
+  }
+
+  // 释放 list 开头所有已经安全的对象（list 中的纪元是非递减的）。
+  void free_safe(std::deque<Retired> &list) {
+    uint64_t current = epoch();
+    while (!list.empty() && list.front().epoch + 2 <= current) {
+      Retired r = list.front();
+      list.pop_front();
+      r.deleter(r.ptr);
+    }
+  }
+
+  void collect(Participant *p) {
+    try_advance();
+    free_safe(p->retired);
+    p->retires_since_collect = 0;
+    // 顺便处理已注销线程留下的对象。只用 try_lock，不让回收阻塞调用者。
+    std::unique_lock lk(orphans_mutex_, std::try_to_lock);
+    if (lk.owns_lock()) {
+      free_safe(orphans_);
+    }
+  }
+
+  // 线程注销时，把它还没来得及释放的对象交给 Domain。
+  void adopt(std::deque<Retired> &list) {
+    std::scoped_lock lk(orphans_mutex_);
+    for (auto &r : list) {
+      orphans_.push_back(r);
+    }
+    list.clear();
+  }
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> epoch_{2};
+  alignas(kCacheLineSize) std::atomic<Participant *> head_{nullptr};
+  std::mutex orphans_mutex_;
+  std::deque<Retired> orphans_;
+};
+
+// 一个线程在一个 Domain 中的注册。只能在创建它的线程中使用。
+class Registration {
+public:
+  explicit Registration(Domain &domain)
+      : domain_(domain), participant_(domain.acquire_participant()) {}
+
+  ~Registration() {
+    domain_.collect(participant_);
+    if (!participant_->retired.empty()) {
+      domain_.adopt(participant_->retired);
+    }
+    participant_->in_use.store(false, std::memory_order_release);
+  }
+
+  Registration(const Registration &) = delete;
+  Registration &operator=(const Registration &) = delete;
+
+  // 等到没有读者可能访问 ptr 时，调用 deleter(ptr)。调用者必须已经把 ptr 从共享数据结构中摘下，
+  // 之后进入临界区的读者不会再找到它。
+  void retire(void *ptr, void (*deleter)(void *)) {
+    participant_->retired.push_back({ptr, deleter, domain_.epoch()});
+    if (++participant_->retires_since_collect >= Domain::kCollectInterval) {
+      domain_.collect(participant_);
+    }
+  }
+
+  // 用 delete 释放 ptr。
+  template <typename T> void retire(T *ptr) {
+    retire(ptr, [](void *p) { delete static_cast<T *>(p); });
+  }
+
+  // 立即尝试推进纪元并释放已经安全的对象。
+  void collect() { domain_.collect(participant_); }
+
+  // 本线程中还在等待释放的对象个数。
+  size_t pending() const { return participant_->retired.size(); }
+
+private:
+  friend class Guard;
+
+  Domain &domain_;
+  Participant *participant_;
+};
+
+// 读者的临界区（RAII）。可以嵌套，只有最外层的 Guard 会记录和清除纪元。
+class Guard {
+public:
+  explicit Guard(Registration &reg) : participant_(reg.participant_) {
+    if (participant_->nesting++ == 0) {
+      uint64_t epoch = reg.domain_.epoch_.load(std::memory_order_relaxed);
+      participant_->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+      // 保证其他线程先看到我们进入了临界区，我们才开始读取共享数据。
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  ~Guard() {
+    if (--participant_->nesting == 0) {
+      // release：临界区中的读取都发生在清除记录之前。
+      participant_->state.store(0, std::memory_order_release);
+    }
+  }
+
+  Guard(const Guard &) = delete;
+  Guard &operator=(const Guard &) = delete;
+
+private:
+  Participant *participant_;
+};
+
+} // namespace ebr
@@ -0,0 +1,360 @@
+// mutex.cpp 中的每个线程调用 add_count 时，都要获取锁、做一次很小的操作、再释放锁。
+// 线程很多时，锁本身和被保护的数据在各个核之间来回传递：每次操作都要先把锁的缓存行、
+// 再把数据的缓存行搬到自己的核上，真正的操作反而只占很小一部分时间。
+
+// 这个文件实现"平面合并"（flat combining）：
+//   - 每个线程不直接获取锁，而是把自己要做的操作"发布"到一个属于自己的槽（slot）中；
+//   - 然后尝试获取锁。获取到锁的线程成为"合并者"（combiner），它扫描所有槽，
+//     依次执行所有已经发布的操作（包括别人的），把结果写回各自的槽，再释放锁；
+//   - 没有获取到锁的线程只需等待自己的槽被标记为完成（或者锁空闲后自己来当合并者）；
+//   - 没有争用时（锁空闲），线程直接获取锁执行自己的操作，不发布也不扫描，开销和普通的锁相近。
+// 这样，被保护的数据结构一直留在合并者的缓存中，一次加锁就完成一批操作，
+// 而等待的线程只在自己的槽所在的缓存行上自旋。
+
+// FlatCombiner<Structure> 对被保护的数据结构是通用的：apply(fn) 会在持有锁的情况下调用
+// fn(structure)，并把 fn 的返回值返回给调用者，就像直接加锁调用一样。
+// 如果 fn 抛出异常（例如 std::queue::push 抛出 std::bad_alloc），锁会被释放，
+// 异常会被传回调用 apply 的线程并在那里重新抛出，就像 std::scoped_lock 在异常时解锁一样；
+// 合并者也会继续执行其他线程的操作，不会让它们一直等待。
+// 下面的基准测试分别用它保护一个计数器、一个队列和一个优先队列。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::exception_ptr、std::current_exception、std::rethrow_exception。
+#include <exception>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::unique_ptr、std::addressof。
+#include <memory>
+// 包含mutex库头文件。
+#include <mutex>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::priority_queue、std::queue。
+#include <queue>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::invoke_result_t、std::is_void_v、std::is_reference_v。
+#include <type_traits>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+// 包含 _mm_pause。
+#include <immintrin.h>
+#endif
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+// 告诉 CPU 当前处于自旋等待循环中。
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+template <typename Structure> class FlatCombiner {
+  enum State : int { kEmpty, kPending, kDone };
+
+  // 发布记录。操作用一个函数指针加一个指向调用者栈上对象的指针表示，发布时不需要分配内存。
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<bool> claimed{false};
+    std::atomic<int> state{kEmpty};
+    void (*invoke)(Structure &, void *) = nullptr;
+    void *context = nullptr;
+    // 操作抛出的异常。由合并者写入，在 state 变成 kDone 之后由发布操作的线程取走。
+    std::exception_ptr error;
+  };
+
+  // 离开作用域时释放 locked_，即使被保护的操作抛出了异常。
+  class Unlocker {
+  public:
+    explicit Unlocker(std::atomic<bool> &locked) : locked_(locked) {}
+    ~Unlocker() { locked_.store(false, std::memory_order_release); }
+    Unlocker(const Unlocker &) = delete;
+    Unlocker &operator=(const Unlocker &) = delete;
+
+  private:
+    std::atomic<bool> &locked_;
+  };
+
+public:
+  // slot_count 会被向上取整为 2 的幂。同时调用 apply 的线程数超过槽数时也能正确工作，
+  // 只是多出来的线程要等待空闲的槽。
+  template <typename... Args>
+  explicit FlatCombiner(size_t slot_count, Args &&...args)
+      : structure_(std::forward<Args>(args)...) {
+    size_t count = 1;
+    while (count < slot_count) {
+      count *= 2;
+    }
+    mask_ = count - 1;
+    slots_.reset(new Slot[count]);
+  }
+
+  FlatCombiner(const FlatCombiner &) = delete;
+  FlatCombiner &operator=(const FlatCombiner &) = delete;
+
+  // 在锁的保护下执行 fn(structure) 并返回它的结果。fn 可能在另一个线程（合并者）中执行。
+  // 结果放在 std::optional 中，所以 R 不需要有默认构造函数；如果 R 是引用，就保存一个指针。
+  template <typename Fn> auto apply(Fn fn) -> std::invoke_result_t<Fn &, Structure &> {
+    using R = std::invoke_result_t<Fn &, Structure &>;
+    if constexpr (std::is_void_v<R>) {
+      apply_impl(&fn, [](Structure &s, void *ctx) { (*static_cast<Fn *>(ctx))(s); });
+    } else {
+      using Stored = std::conditional_t<std::is_reference_v<R>, std::remove_reference_t<R> *, R>;
+      struct Context {
+        Fn *fn;
+        std::optional<Stored> result;
+      } ctx{&fn, std::nullopt};
+      apply_impl(&ctx, [](Structure &s, void *c) {
+        auto *context = static_cast<Context *>(c);
+        if constexpr (std::is_reference_v<R>) {
+          auto &&result = (*context->fn)(s);
+          context->result.emplace(std::addressof(result));
+        } else {
+          context->result.emplace((*context->fn)(s));
+        }
+      });
+      if constexpr (std::is_reference_v<R>) {
+        return static_cast<R>(**ctx.result);
+      } else {
+        return std::move(*ctx.result);
+      }
+    }
+  }
+
+private:
+  void apply_impl(void *context, void (*invoke)(Structure &, void *)) {
+    // 快速路径：锁是空闲的，说明此刻没有争用，直接执行自己的操作，不需要发布，也不扫描槽。
+    // 如果有线程在这期间发布了操作，它会在我们释放锁之后自己成为合并者。
+    if (!locked_.load(std::memory_order_relaxed) &&
+        !locked_.exchange(true, std::memory_order_acquire)) {
+      Unlocker unlock(locked_);
+      invoke(structure_, context);
+      return;
+    }
+
+    Slot &slot = claim_slot();
+    slot.invoke = invoke;
+    slot.context = context;
+    // release：合并者看到 kPending 时，也能看到上面写入的 invoke 和 context。
+    slot.state.store(kPending, std::memory_order_release);
+
+    for (int spins = 0;; ++spins) {
+      if (slot.state.load(std::memory_order_acquire) == kDone) {
+        break;
+      }
+      if (!locked_.load(std::memory_order_relaxed) &&
+          !locked_.exchange(true, std::memory_order_acquire)) {
+        Unlocker unlock(locked_);
+        combine();
+        // 我们自己的操作一定在这一轮中被执行了。
+        break;
+      }
+      if (spins < 1024) {
+        cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    std::exception_ptr error = std::move(slot.error);
+    slot.error = nullptr;
+    slot.state.store(kEmpty, std::memory_order_relaxed);
+    slot.claimed.store(false, std::memory_order_release);
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // 扫描所有槽，执行所有已发布的操作。某个操作抛出的异常保存在它的槽中，
+  // 交给发布它的线程重新抛出，合并者继续执行后面的操作。
+  void combine() {
+    for (size_t i = 0; i <= mask_; ++i) {
+      Slot &slot = slots_[i];
+      if (slot.state.load(std::memory_order_acquire) == kPending) {
+        try {
+          slot.invoke(structure_, slot.context);
+        } catch (...) {
+          slot.error = std::current_exception();
+        }
+        slot.state.store(kDone, std::memory_order_release);
+      }
+    }
+  }
+
+  // 每个线程优先使用由自己的编号决定的槽，被占用时再依次尝试后面的槽。
+  Slot &claim_slot() {
+    static std::atomic<size_t> next_thread{0};
+    thread_local size_t hint = next_thread.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = hint;; ++i) {
+      Slot &slot = slots_[i & mask_];
+      if (!slot.claimed.load(std::memory_order_relaxed) &&
+          !slot.claimed.exchange(true, std::memory_order_acquire)) {
+        return slot;
+      }
+      if (((i + 1) & mask_) == (hint & mask_)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  alignas(kCacheLineSize) std::atomic<bool> locked_{false};
+  alignas(kCacheLineSize) Structure structure_;
+  size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+// 作为对照：每次操作都获取一次 std::mutex，和 mutex.cpp 中的 add_count 相同。
+template <typename Structure> class PerOpLocked {
+public:
+  template <typename... Args>
+  explicit PerOpLocked(size_t, Args &&...args) : structure_(std::forward<Args>(args)...) {}
+
+  template <typename Fn> auto apply(Fn fn) {
+    std::scoped_lock slk(m_);
+    return fn(structure_);
+  }
+
+private:
+  std::mutex m_;
+  Structure structure_;
+};
+
+// 与 mutex.cpp 中相同的 add_count 函数，只是通过 FlatCombiner 给 count 加一。
+FlatCombiner<int> count(64, 0);
+
+void add_count() {
+  count.apply([](int &c) { c += 1; });
+}
+
+// threads 个线程各执行 ops_per_thread 次 op(executor, thread, i)，返回吞吐量（百万次操作/秒）。
+template <typename Executor, typename Op> double run(int threads, int ops_per_thread, Op op) {
+  Executor executor(64);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      for (int i = 0; i < ops_per_thread; ++i) {
+        op(executor, t, i);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+// 分别用两种方式运行同一个操作，打印一行结果。
+template <typename Structure, typename Op> void compare(const char *name, Op op) {
+  const int ops_per_thread = 100000;
+  std::cout << name << "\n";
+  for (int threads : {1, 2, 4, 8}) {
+    double a = run<PerOpLocked<Structure>>(threads, ops_per_thread, op);
+    double b = run<FlatCombiner<Structure>>(threads, ops_per_thread, op);
+    std::cout << "  " << threads << " threads: per-op mutex " << a << " Mops/s, flat combining "
+              << b << " Mops/s\n";
+  }
+}
+
+int main() {
+  // 首先，我们像 mutex.cpp 中那样让两个线程各调用一次 add_count。
+  std::thread t1(add_count);
+  std::thread t2(add_count);
+  t1.join();
+  t2.join();
+  std::cout << "Printing count: " << count.apply([](int &c) { return c; }) << std::endl;
+
+  // 检查：8 个线程各加 10000 次，结果应该是 80000。
+  FlatCombiner<long long> counter(64, 0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 8; ++t) {
+    workers.emplace_back([&counter]() {
+      for (int i = 0; i < 10000; ++i) {
+        counter.apply([](long long &c) { c += 1; });
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::cout << "Counter after 8 x 10000 increments: "
+            << counter.apply([](long long &c) { return c; }) << "\n";
+
+  // 检查：操作抛出异常时，异常传回调用者，锁被释放，之后的操作照常执行。
+  // 8 个线程中每第 10 次操作抛出异常，其余的操作加一，结果应该是 8 x 9000 = 72000。
+  FlatCombiner<long long> throwing(64, 0);
+  std::atomic<int> caught{0};
+  workers.clear();
+  for (int t = 0; t < 8; ++t) {
+    workers.emplace_back([&throwing, &caught]() {
+      for (int i = 0; i < 10000; ++i) {
+        try {
+          throwing.apply([i](long long &c) {
+            if (i % 10 == 0) {
+              throw std::runtime_error("operation failed");
+            }
+            c += 1;
+          });
+        } catch (const std::runtime_error &) {
+          caught.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::cout << "Counter with failing operations: "
+            << throwing.apply([](long long &c) { return c; }) << ", caught " << caught.load()
+            << " exceptions\n";
+
+  // 基准测试：计数器、队列（交替 push 和 pop）、优先队列（交替 push 和 pop）。
+  // 注意：在核数很少的机器上，线程不能真正并行执行，也就很少有多个操作同时等待被合并；
+  // 需要在多核机器上运行才能看到平面合并在高争用下的优势。
+  std::cout << "Benchmark:\n";
+  compare<long long>("counter += 1",
+                     [](auto &ex, int, int) { ex.apply([](long long &c) { c += 1; }); });
+  compare<std::queue<int>>("queue push/pop", [](auto &ex, int t, int i) {
+    if (i % 2 == 0) {
+      ex.apply([t](std::queue<int> &q) { q.push(t); });
+    } else {
+      ex.apply([](std::queue<int> &q) {
+        int v = -1;
+        if (!q.empty()) {
+          v = q.front();
+          q.pop();
+        }
+        return v;
+      });
+    }
+  });
+  compare<std::priority_queue<int>>("priority_queue push/pop", [](auto &ex, int t, int i) {
+    if (i % 2 == 0) {
+      ex.apply([v = (i * 7919 + t) % 100003](std::priority_queue<int> &q) { q.push(v); });
+    } else {
+      ex.apply([](std::priority_queue<int> &q) {
+        int v = -1;
+        if (!q.empty()) {
+          v = q.top();
+          q.pop();
+        }
+        return v;
+      });
+    }
+  });
+
+  return 0;
+}
@@ -0,0 +1,253 @@
+// scoped_lock.cpp 中所有线程都通过同一个 std::mutex m 来保护 count。
+// 线程很多时，所有等待者都在同一把锁上自旋或睡眠：锁被释放的瞬间，所有自旋的线程同时去抢
+// 同一个缓存行，这个缓存行在各个核之间来回传递；而最终抢到锁的线程是随机的，
+// 运气不好的线程可能等很久（不公平，unfair）。
+
+// 这个文件实现 MCS 锁（以发明者 Mellor-Crummey 和 Scott 命名），一种基于队列的锁：
+//   - 每个等待的线程有一个自己的队列节点（QNode），锁本身只保存指向队尾节点的指针；
+//   - 获取锁时，线程用一次原子交换把自己的节点放到队尾，然后只在自己节点的 locked 标志上自旋；
+//   - 释放锁时，持有者把队列中下一个节点的 locked 标志清零，直接把锁交给它。
+// 所以每个等待者只读写自己的缓存行，释放锁只会让一个线程的缓存行失效；
+// 而且线程按照到达的顺序获得锁（先进先出，FIFO），不会有线程饿死。
+
+// 标准的 MCS 锁要求调用者在 lock 和 unlock 时传入同一个节点，但标准库的 Lockable 接口只有
+// 无参数的 lock() 和 unlock()。我们让每个线程拥有一小组线程局部的节点，
+// lock() 从中取出一个空闲节点，并把它记在锁里（只有持有锁的线程会读写这个成员），
+// unlock() 再把它取回来。这样 McsLock 就可以用于 std::scoped_lock 和 std::unique_lock。
+
+// 注意：纯自旋的队列锁假设每个等待者都在自己的核上运行。如果线程数超过核数，
+// 队列中下一个线程可能没有被调度，锁交给它之后就空等着，所有线程都要等它被调度（队列锁对此尤其敏感）。
+// 因此我们的等待者自旋一段时间后会调用 std::this_thread::yield() 让出 CPU。
+
+// 包含 std::sort。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含互斥锁库头文件。
+#include <mutex>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含线程库头文件。
+#include <thread>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+// 包含 _mm_pause。
+#include <immintrin.h>
+#endif
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+// 告诉 CPU 当前处于自旋等待循环中。
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// 等待 done() 返回 true：先自旋，自旋太久就开始让出 CPU。
+template <typename Pred> void spin_until(Pred done) {
+  for (int spins = 0; !done(); ++spins) {
+    if (spins < 1024) {
+      cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+class McsLock {
+  // 每个节点独占一个缓存行，等待者只在自己的缓存行上自旋。
+  struct alignas(kCacheLineSize) QNode {
+    std::atomic<QNode *> next{nullptr};
+    std::atomic<bool> locked{false};
+    bool in_use = false;
+  };
+
+  // 一个线程最多同时持有 kMaxHeld 把 McsLock。
+  static constexpr int kMaxHeld = 16;
+
+public:
+  McsLock() = default;
+  McsLock(const McsLock &) = delete;
+  McsLock &operator=(const McsLock &) = delete;
+
+  void lock() {
+    QNode *node = acquire_node();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+    // 把自己放到队尾。acq_rel：release 让前驱看到我们对节点的初始化，
+    // acquire 让我们看到前驱节点的内容。
+    QNode *prev = tail_.exchange(node, std::memory_order_acq_rel);
+    if (prev != nullptr) {
+      // 队列不为空：把自己链到前驱后面，然后等前驱把锁交给我们。
+      prev->next.store(node, std::memory_order_release);
+      spin_until([node] { return !node->locked.load(std::memory_order_acquire); });
+    }
+    owner_ = node;
+  }
+
+  bool try_lock() {
+    QNode *node = acquire_node();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    QNode *expected = nullptr;
+    // 成功时和 lock() 一样使用 acq_rel：release 保证之后排到我们后面的线程
+    // 在写 node->next 之前能看到上面对它的清空，否则它的链接可能被覆盖而永远等不到锁。
+    if (tail_.compare_exchange_strong(expected, node, std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+      owner_ = node;
+      return true;
+    }
+    node->in_use = false;
+    return false;
+  }
+
+  void unlock() {
+    QNode *node = owner_;
+    QNode *next = node->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      // 看起来没有后继。如果队尾仍然是我们自己，把队列清空就完成了。
+      QNode *expected = node;
+      if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+        node->in_use = false;
+        return;
+      }
+      // 有一个线程已经把自己放到了队尾，但还没来得及链到我们后面，等它完成。
+      spin_until([&] { return (next = node->next.load(std::memory_order_acquire)) != nullptr; });
+    }
+    // 把锁直接交给下一个线程。
+    next->locked.store(false, std::memory_order_release);
+    node->in_use = false;
+  }
+
+private:
+  // 从当前线程的节点中取出一个空闲的。
+  static QNode *acquire_node() {
+    thread_local QNode nodes[kMaxHeld];
+    for (auto &node : nodes) {
+      if (!node.in_use) {
+        node.in_use = true;
+        return &node;
+      }
+    }
+    throw std::runtime_error("McsLock: too many locks held by one thread");
+  }
+
+  alignas(kCacheLineSize) std::atomic<QNode *> tail_{nullptr};
+  // 当前持有者的节点。只有持有锁的线程读写它，所以不需要是原子的。
+  // 它独占一个缓存行：每个新来的等待者都要对 tail_ 做 exchange，
+  // 如果 owner_ 和 tail_ 在同一个缓存行上，持有者每次写 owner_ 都会和它们争抢这个缓存行。
+  alignas(kCacheLineSize) QNode *owner_ = nullptr;
+};
+
+// 作为对照的"测试-测试-设置"（test-and-test-and-set）自旋锁：所有等待者在同一个标志上自旋，
+// 锁被释放时它们同时去抢，谁抢到是随机的。
+class TtasLock {
+public:
+  void lock() {
+    while (flag_.exchange(true, std::memory_order_acquire)) {
+      spin_until([this] { return !flag_.load(std::memory_order_relaxed); });
+    }
+  }
+  bool try_lock() { return !flag_.exchange(true, std::memory_order_acquire); }
+  void unlock() { flag_.store(false, std::memory_order_release); }
+
+private:
+  std::atomic<bool> flag_{false};
+};
+
+// 与 scoped_lock.cpp 中相同的全局 count 和 add_count 函数，只是把 std::mutex 换成了 McsLock。
+int count = 0;
+McsLock m;
+
+void add_count() {
+  std::scoped_lock slk(m);
+  count += 1;
+}
+
+// 基准测试的结果：吞吐量、获取锁的等待时间的 99 分位数和最大值，
+// 以及公平性（获得锁次数最多和最少的线程之比）。
+struct Result {
+  double mops;
+  double p99_us;
+  double max_us;
+  double fairness;
+};
+
+// threads 个线程在 duration 时间内不断地"获取锁、count += 1、释放锁"。
+// 按时间而不是按次数运行，这样才能看出各个线程分别获得了多少次锁。
+template <typename Lock> Result run(int threads, std::chrono::milliseconds duration) {
+  Lock lock;
+  long long counter = 0;
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<double>> samples(threads);
+  std::vector<long long> acquired(threads, 0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      auto &mine = samples[t];
+      while (!stop.load(std::memory_order_relaxed)) {
+        auto before = std::chrono::steady_clock::now();
+        {
+          std::scoped_lock slk(lock);
+          counter += 1;
+        }
+        std::chrono::duration<double, std::micro> waited =
+            std::chrono::steady_clock::now() - before;
+        mine.push_back(waited.count());
+        ++acquired[t];
+      }
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::vector<double> all;
+  for (auto &s : samples) {
+    all.insert(all.end(), s.begin(), s.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto [fewest, most] = std::minmax_element(acquired.begin(), acquired.end());
+  std::chrono::duration<double> seconds = duration;
+  return {counter / seconds.count() / 1e6, all[all.size() * 99 / 100], all.back(),
+          static_cast<double>(*most) / std::max(*fewest, 1LL)};
+}
+
+template <typename Lock> void report(const char *name, int threads) {
+  Result r = run<Lock>(threads, std::chrono::milliseconds(200));
+  std::cout << "  " << name << r.mops << " Mops/s, p99 " << r.p99_us << " us, max " << r.max_us
+            << " us, most/fewest acquisitions " << r.fairness << "\n";
+}
+
+int main() {
+  // 首先，我们像 scoped_lock.cpp 中那样让两个线程各调用一次 add_count。
+  std::thread t1(add_count);
+  std::thread t2(add_count);
+  t1.join();
+  t2.join();
+  std::cout << "Printing count: " << count << std::endl;
+
+  // 基准测试：2 到 64 个线程，比较 std::mutex、TTAS 自旋锁和 MCS 锁。
+  // 注意：在核数很少的机器上，线程数超过核数之后，等待时间主要由操作系统的调度决定，
+  // 而不是由锁的设计决定；需要在多核机器上运行才能看到 MCS 锁在高争用下的优势。
+  for (int threads : {2, 4, 8, 16, 32, 64}) {
+    std::cout << threads << " threads:\n";
+    report<std::mutex>("std::mutex: ", threads);
+    report<TtasLock>("TtasLock:   ", threads);
+    report<McsLock>("McsLock:    ", threads);
+  }
+
+  return 0;
+}
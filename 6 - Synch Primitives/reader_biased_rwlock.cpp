@@ -0,0 +1,273 @@
+// rwlock.cpp 中的 read_value 用 std::shared_lock 获取 std::shared_mutex 的读锁。
+// 多个读者可以同时持有读锁，但获取和释放读锁时，每个读者都要对锁内部的同一个读者计数器
+// 做一次原子的读-改-写。这个计数器所在的缓存行在各个核之间来回传递，
+// 所以即使全是读操作、临界区很短，读者越多，每次读反而越慢。
+
+// 这个文件实现一个偏向读者的读写锁 ReaderBiasedRWLock（思路与 Linux 内核的 percpu_rw_semaphore
+// 相同）：
+//   - 读者计数被拆分到多个槽中，每个槽独占一个缓存行。每个线程固定使用一个槽，
+//     获取读锁只是给自己的槽加一，再检查一下有没有写者，不会和其他读者争抢缓存行；
+//   - 写者先用一把普通的互斥锁排除其他写者，再设置 writer_ 标志"撤销"读者的快速路径，
+//     然后等待所有槽归零（"排空"，drain），也就是等待已经进入的读者全部离开；
+//   - 读者看到 writer_ 标志后，撤销自己刚才的加一，在写者的互斥锁上排队等写者结束，再重试。
+// 这是一个"先写自己的变量、再读对方的变量"的握手：读者先给槽加一再读 writer_，
+// 写者先设置 writer_ 再读各个槽。两边的四个操作都必须使用 seq_cst 顺序，
+// 才能保证至少有一方看到对方：要么写者看到读者的计数，要么读者看到写者的标志。
+// 如果写者用 acquire 读取槽，C++ 内存模型允许两边都看不到对方（store buffering），
+// 写者就可能在读者还在临界区中时进入。
+// 代价是写操作变慢了：写者要扫描所有的槽。这个锁适合读远多于写的场景。
+
+// ReaderBiasedRWLock 提供 lock/try_lock/unlock 和 lock_shared/try_lock_shared/unlock_shared，
+// 满足标准库的 SharedLockable 要求，所以可以直接用于 std::shared_lock 和 std::unique_lock。
+
+// 包含 std::sort。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含mutex库头文件。
+#include <mutex>
+// 包含shared mutex库头文件。
+#include <shared_mutex>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+// 包含 _mm_pause。
+#include <immintrin.h>
+#endif
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+// 告诉 CPU 当前处于自旋等待循环中。
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+class ReaderBiasedRWLock {
+  // 每个槽独占一个缓存行。
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<int> readers{0};
+  };
+
+public:
+  // slot_count 会被向上取整为 2 的幂。默认槽数是硬件线程数的两倍。
+  explicit ReaderBiasedRWLock(size_t slot_count = 2 * std::thread::hardware_concurrency()) {
+    size_t count = 1;
+    while (count < slot_count) {
+      count *= 2;
+    }
+    mask_ = count - 1;
+    slots_.reset(new Slot[count]);
+  }
+
+  ReaderBiasedRWLock(const ReaderBiasedRWLock &) = delete;
+  ReaderBiasedRWLock &operator=(const ReaderBiasedRWLock &) = delete;
+
+  void lock_shared() {
+    while (!try_lock_shared()) {
+      // 有写者。在写者的互斥锁上等它结束（这里会睡眠，而不是自旋），然后重试。
+      std::scoped_lock wait_for_writer(writer_mutex_);
+    }
+  }
+
+  bool try_lock_shared() {
+    Slot &slot = my_slot();
+    slot.readers.fetch_add(1, std::memory_order_seq_cst);
+    if (!writer_.load(std::memory_order_seq_cst)) {
+      return true;
+    }
+    // 写者已经撤销了快速路径，退出。
+    slot.readers.fetch_sub(1, std::memory_order_release);
+    return false;
+  }
+
+  void unlock_shared() { my_slot().readers.fetch_sub(1, std::memory_order_release); }
+
+  void lock() {
+    writer_mutex_.lock();
+    writer_.store(true, std::memory_order_seq_cst);
+    drain();
+  }
+
+  bool try_lock() {
+    if (!writer_mutex_.try_lock()) {
+      return false;
+    }
+    writer_.store(true, std::memory_order_seq_cst);
+    for (size_t i = 0; i <= mask_; ++i) {
+      if (slots_[i].readers.load(std::memory_order_seq_cst) != 0) {
+        writer_.store(false, std::memory_order_release);
+        writer_mutex_.unlock();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void unlock() {
+    writer_.store(false, std::memory_order_release);
+    writer_mutex_.unlock();
+  }
+
+private:
+  // 等待所有槽归零。读者的临界区通常很短，所以先自旋；自旋太久说明某个读者可能被调度出去了，
+  // 这时短暂睡眠，把 CPU 让给它。（Linux 上的 yield 不一定真的让出 CPU。）
+  void drain() {
+    for (size_t i = 0; i <= mask_; ++i) {
+      for (int spins = 0; slots_[i].readers.load(std::memory_order_seq_cst) != 0; ++spins) {
+        if (spins < 1024) {
+          cpu_relax();
+        } else {
+          std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+      }
+    }
+  }
+
+  // 每个线程的编号在第一次使用时按顺序分配，前 slot_count 个线程一定落在不同的槽上。
+  // 同一个线程的 lock_shared 和 unlock_shared 总是使用同一个槽。
+  Slot &my_slot() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return slots_[index & mask_];
+  }
+
+  alignas(kCacheLineSize) std::atomic<bool> writer_{false};
+  std::mutex writer_mutex_;
+  size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+// 与 rwlock.cpp 中相同的 count、read_value 和 write_value，只是把 std::shared_mutex 换成了
+// ReaderBiasedRWLock。
+int count = 0;
+ReaderBiasedRWLock m;
+
+void read_value() {
+  std::shared_lock lk(m);
+  std::cout << "Reading value " + std::to_string(count) + "\n" << std::flush;
+}
+
+void write_value() {
+  std::unique_lock lk(m);
+  count += 3;
+}
+
+// 读扩展性：threads 个读者各读 ops_per_thread 次，返回吞吐量（百万次操作/秒）。
+template <typename Lock> double read_throughput(int threads, int ops_per_thread) {
+  Lock lock;
+  int value = 0;
+  std::atomic<long long> sink{0};
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&]() {
+      long long sum = 0;
+      for (int i = 0; i < ops_per_thread; ++i) {
+        std::shared_lock lk(lock);
+        sum += value;
+      }
+      sink += sum;
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+// 写者延迟：readers 个读者不停地读，同时一个写者执行 writes 次写操作，
+// 返回写者获取锁的等待时间的中位数和最大值（微秒）。
+template <typename Lock> std::pair<double, double> writer_latency(int readers, int writes) {
+  Lock lock;
+  int value = 0;
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < readers; ++t) {
+    workers.emplace_back([&]() {
+      long long sum = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        std::shared_lock lk(lock);
+        sum += value;
+      }
+      if (sum < 0) {
+        std::cout << "impossible\n";
+      }
+    });
+  }
+  std::vector<double> samples;
+  for (int i = 0; i < writes; ++i) {
+    // 在临界区内读取结束时间：释放锁时被唤醒的读者可能立即抢占写者，这段时间不应计入等待时间。
+    auto before = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::micro> waited;
+    {
+      std::unique_lock lk(lock);
+      waited = std::chrono::steady_clock::now() - before;
+      value += 3;
+    }
+    samples.push_back(waited.count());
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  stop = true;
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.back()};
+}
+
+int main() {
+  // 首先，我们像 rwlock.cpp 中那样运行两个写者和四个读者。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 基准测试 1：只有读者时的吞吐量。
+  // 注意：在核数很少的机器上，读者不能真正并行执行，看不到 std::shared_mutex 的计数器争用，
+  // 需要在多核机器上运行才能看到读者数增加时两者的差距。
+  const int ops_per_thread = 500000;
+  std::cout << "readers  std::shared_mutex(Mops/s)  ReaderBiasedRWLock(Mops/s)\n";
+  for (int threads : {1, 2, 4, 8}) {
+    double a = read_throughput<std::shared_mutex>(threads, ops_per_thread);
+    double b = read_throughput<ReaderBiasedRWLock>(threads, ops_per_thread);
+    std::cout << threads << "        " << a << "                  " << b << "\n";
+  }
+
+  // 基准测试 2：读者不停读取时，写者获取锁的等待时间。
+  std::cout << "readers  writer p50/max(us): std::shared_mutex  ReaderBiasedRWLock\n";
+  for (int readers : {1, 4}) {
+    auto a = writer_latency<std::shared_mutex>(readers, 50);
+    auto b = writer_latency<ReaderBiasedRWLock>(readers, 50);
+    std::cout << readers << "                            " << a.first << "/" << a.second
+              << "  " << b.first << "/" << b.second << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,314 @@
+// rwlock.cpp 中被保护的只是一个 int count，读取（read_value）远比写入（write_value 加 3）频繁。
+// 用 std::shared_mutex 保护它时，每个读者都要修改锁内部的读者计数器，
+// 读者之间虽然不互相阻塞，却在争抢同一个缓存行。
+
+// 对于这种"读多写少的小数据"，顺序锁（seqlock）是更好的选择：
+//   - 数据旁边有一个序列号（sequence number）。写者在修改数据之前把序列号加一（变成奇数），
+//     修改完成后再加一（变回偶数）；
+//   - 读者先读序列号，如果是奇数说明写者正在修改，稍后重试；然后拷贝数据，再读一次序列号，
+//     如果两次读到的序列号相同，说明拷贝期间没有写者，拷贝出来的数据是一致的，否则重试。
+// 读者从不写共享内存，所以任意多个读者可以同时读取，缓存行一直处于共享状态。
+// 代价是读者可能需要重试，而且读者拿到的是数据的拷贝，所以只适用于可以按字节拷贝的小数据。
+
+// 注意 C++ 内存模型的一个细节：读者拷贝数据的同时写者可能正在修改它，
+// 如果用普通的 memcpy，这是数据竞争（data race），属于未定义行为，即使我们随后会丢弃这份拷贝。
+// 所以 SeqLock 把数据存放在一组 std::atomic<uint64_t> 字中，读写都使用 relaxed 的原子操作，
+// 再配合内存屏障（fence）保证顺序。在 x86 和 ARM 上，relaxed 的原子读写就是普通的读写指令。
+
+// 包含 std::atomic、std::atomic_thread_fence。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 uint32_t、uint64_t 等定长整数类型。
+#include <cstdint>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含mutex库头文件。
+#include <mutex>
+// 包含 std::launder。
+#include <new>
+// 包含shared mutex库头文件。
+#include <shared_mutex>
+// 包含 C++ 字符串库。
+#include <string>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::is_trivially_copyable_v。
+#include <type_traits>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+// 包含 _mm_pause。
+#include <immintrin.h>
+#endif
+
+// 告诉 CPU 当前处于自旋等待循环中。
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// T 只需要是可平凡拷贝的（trivially copyable），不需要有默认构造函数：
+// load 和 update 把字节拷贝进一块按 T 对齐的存储中得到 T，而不是先默认构造一个 T 再覆盖它。
+// 只有不带参数构造 SeqLock 时，才需要 T 可以默认构造。
+template <typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock requires a trivially copyable type");
+
+  // 存放 T 需要的 64 位字的个数。
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+  explicit SeqLock(const T &value = T()) { store_words(value); }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  // 读取一个一致的拷贝。如果读取期间有写者，就重试。
+  T load() const {
+    for (;;) {
+      uint64_t before = seq_.load(std::memory_order_acquire);
+      if (before & 1) {
+        // 写者正在修改。
+        cpu_relax();
+        continue;
+      }
+      uint64_t buffer[kWords];
+      for (size_t i = 0; i < kWords; ++i) {
+        buffer[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      // 保证上面对数据的读取不会被重排到下面对序列号的读取之后。
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) {
+        Storage storage;
+        return storage.from(buffer);
+      }
+    }
+  }
+
+  void store(const T &value) {
+    uint64_t seq = begin_write();
+    store_words(value);
+    end_write(seq);
+  }
+
+  // 原子地完成"读取-修改-写回"：fn 接收当前值的引用并修改它。例如 rwlock.cpp 中的 write_value：
+  //   count.update([](int &c) { c += 3; });
+  template <typename Fn> void update(Fn fn) {
+    uint64_t seq = begin_write();
+    // 写者持有"写锁"，其他写者不会同时修改数据；begin_write 的 acquire 保证这里能读到
+    // 上一个写者写入的全部数据。
+    uint64_t buffer[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    Storage storage;
+    T &value = storage.from(buffer);
+    fn(value);
+    store_words(value);
+    end_write(seq);
+  }
+
+private:
+  // 一块按 T 对齐、大小为 sizeof(T) 的存储。T 是可平凡拷贝的，
+  // 把一个 T 的字节拷贝进来，这块存储中就有了一个值相同的 T 对象。
+  struct Storage {
+    T &from(const uint64_t *buffer) {
+      std::memcpy(bytes, buffer, sizeof(T));
+      return *std::launder(reinterpret_cast<T *>(bytes));
+    }
+
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+
+  // 写者之间的互斥也由序列号完成：把偶数的序列号加一（变成奇数）的写者获得写权限。
+  // 返回加一之前的序列号。
+  uint64_t begin_write() {
+    uint64_t seq = seq_.load(std::memory_order_relaxed);
+    for (;;) {
+      // 成功时用 acquire：和上一个写者在 end_write 中的 release 同步，就像获取一把锁，
+      // 之后的读取和写入都发生在上一个写者的写入之后。
+      if (!(seq & 1) && seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                   std::memory_order_relaxed)) {
+        break;
+      }
+      cpu_relax();
+      seq = seq_.load(std::memory_order_relaxed);
+    }
+    // 保证下面对数据的写入不会被重排到序列号变成奇数之前。
+    std::atomic_thread_fence(std::memory_order_release);
+    return seq;
+  }
+
+  // release：读者看到新的偶数序列号时，也一定能看到我们写入的数据。
+  void end_write(uint64_t seq) { seq_.store(seq + 2, std::memory_order_release); }
+
+  void store_words(const T &value) {
+    uint64_t buffer[kWords] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> seq_{0};
+  std::atomic<uint64_t> words_[kWords];
+};
+
+// 与 rwlock.cpp 中相同的 read_value 和 write_value，只是用 SeqLock 保护 count。
+SeqLock<int> count(0);
+
+void read_value() {
+  std::cout << "Reading value " + std::to_string(count.load()) + "\n" << std::flush;
+}
+
+void write_value() {
+  count.update([](int &c) { c += 3; });
+}
+
+// 基准测试的负载：Bytes 个字节，由相同的 uint32_t 组成。读者检查所有的 uint32_t 是否相同，
+// 以此发现"撕裂"的读取（一部分来自旧值，一部分来自新值）。
+template <size_t Bytes> struct Payload {
+  uint32_t v[Bytes / sizeof(uint32_t)];
+
+  static Payload make(uint32_t x) {
+    Payload p;
+    for (auto &e : p.v) {
+      e = x;
+    }
+    return p;
+  }
+  bool consistent() const {
+    for (auto e : v) {
+      if (e != v[0]) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// 三种保护方式，接口相同：load() 和 store(value)。
+template <typename T> class SharedMutexCell {
+public:
+  T load() const {
+    std::shared_lock lk(m_);
+    return value_;
+  }
+  void store(const T &value) {
+    std::unique_lock lk(m_);
+    value_ = value;
+  }
+
+private:
+  mutable std::shared_mutex m_;
+  T value_{};
+};
+
+// std::atomic<T> 只对很小的 T 是无锁的（通常不超过 8 或 16 个字节）。更大的 T 由 libatomic
+// 内部的锁保护，还需要额外链接 libatomic，所以基准测试只在 4 字节时和它比较。
+template <typename T> class AtomicCell {
+public:
+  T load() const { return value_.load(std::memory_order_acquire); }
+  void store(const T &value) { value_.store(value, std::memory_order_release); }
+
+private:
+  std::atomic<T> value_{};
+};
+
+struct Result {
+  double read_mops;
+  double write_mops;
+  long long torn;
+};
+
+// readers 个读者和一个写者同时运行 duration 时间。写者每次写入后让出 CPU，模拟"写少"。
+template <typename Cell, typename T> Result run(int readers, std::chrono::milliseconds duration) {
+  Cell cell;
+  cell.store(T::make(0));
+  std::atomic<bool> stop{false};
+  std::atomic<long long> reads{0};
+  std::atomic<long long> torn{0};
+  long long writes = 0;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < readers; ++t) {
+    workers.emplace_back([&]() {
+      long long n = 0;
+      long long bad = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        bad += !cell.load().consistent();
+        ++n;
+      }
+      reads += n;
+      torn += bad;
+    });
+  }
+  std::thread writer([&]() {
+    uint32_t x = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      cell.store(T::make(++x));
+      ++writes;
+      std::this_thread::yield();
+    }
+  });
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (auto &w : workers) {
+    w.join();
+  }
+  writer.join();
+  std::chrono::duration<double> seconds = duration;
+  return {reads / seconds.count() / 1e6, writes / seconds.count() / 1e6, torn.load()};
+}
+
+template <typename Cell, typename T> void report(const char *name, int readers) {
+  Result r = run<Cell, T>(readers, std::chrono::milliseconds(200));
+  std::cout << "    " << name << r.read_mops << " Mreads/s, " << r.write_mops << " Mwrites/s, "
+            << r.torn << " torn reads\n";
+}
+
+// Payload 只有一个 uint32_t 时，可以和 std::atomic 比较。
+template <size_t Bytes> void compare(int readers) {
+  using T = Payload<Bytes>;
+  std::cout << "  " << Bytes << " bytes:\n";
+  report<SharedMutexCell<T>, T>("std::shared_mutex: ", readers);
+  report<SeqLock<T>, T>("SeqLock:           ", readers);
+  if constexpr (Bytes == sizeof(uint32_t)) {
+    report<AtomicCell<T>, T>("std::atomic:       ", readers);
+  }
+}
+
+int main() {
+  // 首先，我们像 rwlock.cpp 中那样运行两个写者和四个读者。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 基准测试：不同大小的数据，3 个读者和 1 个写者。
+  // 注意：在核数很少的机器上，读者和写者不能真正并行执行，读者几乎不会遇到正在进行的写入，
+  // 也看不到 std::shared_mutex 读者计数器的争用；需要在多核机器上运行才能看到两者的差距。
+  // 另外，SeqLock 逐个字地用原子操作拷贝数据，编译器不能把它向量化，
+  // 所以数据较大（例如 256 字节）而又没有争用时，单次读取可能比加读锁后 memcpy 还慢。
+  std::cout << "3 readers, 1 writer:\n";
+  compare<4>(3);
+  compare<16>(3);
+  compare<64>(3);
+  compare<256>(3);
+
+  return 0;
+}
@@ -0,0 +1,218 @@
+// mutex.cpp 和 scoped_lock.cpp 中 add_count 的临界区只有一条 count += 1，只需要几纳秒。
+// 但 std::mutex 在发生争用时，等待的线程会很快进入内核睡眠，持有锁的线程释放锁时
+// 还要通过系统调用把它唤醒。一次睡眠加唤醒要花几微秒，比临界区本身长上千倍。
+
+// 这个文件实现一个自适应的互斥锁 SpinFutexMutex：
+//   - 获取锁失败时，先在用户态自旋一小会儿。每次重试之间执行若干条 pause 指令，
+//     次数按指数增长（指数退避，exponential backoff），减少对锁所在缓存行的争抢；
+//     pause 还会告诉 CPU 这是一个自旋等待循环，降低功耗并让出超线程的执行资源；
+//   - 自旋一定次数后仍然拿不到锁，说明持有者可能被调度出去了，或者临界区很长，
+//     这时在 Linux 的 futex（fast userspace mutex）上睡眠，不再浪费 CPU；
+//   - 释放锁时，只有在确实有线程睡眠时才执行 futex 唤醒的系统调用。
+// 锁的状态是一个整数（Ulrich Drepper 的 "Futexes Are Tricky" 中的经典设计）：
+//   0 表示未加锁，1 表示已加锁且没有睡眠的等待者，2 表示已加锁且可能有睡眠的等待者。
+// 在没有 futex 的平台上，睡眠退化为 std::this_thread::yield()。
+
+// SpinFutexMutex 提供 lock、try_lock、unlock 三个成员函数，满足标准库的 Lockable 要求，
+// 所以可以直接用于 std::scoped_lock、std::unique_lock 和 std::lock_guard。
+
+// 包含 std::sort。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含mutex库头文件。
+#include <mutex>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+// 包含 _mm_pause。
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+// 包含 FUTEX_WAIT_PRIVATE、FUTEX_WAKE_PRIVATE。
+#include <linux/futex.h>
+// 包含 SYS_futex。
+#include <sys/syscall.h>
+// 包含 syscall。
+#include <unistd.h>
+#endif
+
+// 告诉 CPU 当前处于自旋等待循环中。
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+class SpinFutexMutex {
+  // 自旋阶段的参数：最多重试 kSpinRounds 次，每次重试前执行的 pause 次数从 1 开始加倍，
+  // 最多 kMaxBackoff 次。
+  static constexpr int kSpinRounds = 10;
+  static constexpr int kMaxBackoff = 64;
+
+public:
+  SpinFutexMutex() = default;
+  SpinFutexMutex(const SpinFutexMutex &) = delete;
+  SpinFutexMutex &operator=(const SpinFutexMutex &) = delete;
+
+  bool try_lock() {
+    int expected = 0;
+    return state_.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  void lock() {
+    // 快速路径：锁是空闲的。
+    if (try_lock()) {
+      return;
+    }
+    // 自旋阶段。只在锁看起来空闲时才尝试 CAS，避免不断地独占缓存行。
+    int backoff = 1;
+    for (int round = 0; round < kSpinRounds; ++round) {
+      for (int i = 0; i < backoff; ++i) {
+        cpu_relax();
+      }
+      if (backoff < kMaxBackoff) {
+        backoff *= 2;
+      }
+      if (state_.load(std::memory_order_relaxed) == 0 && try_lock()) {
+        return;
+      }
+    }
+    // 睡眠阶段。把状态设为 2（表示有等待者），如果交换前的状态是 0，说明我们拿到了锁。
+    // 注意这样拿到锁时状态是 2 而不是 1，unlock 可能会多做一次不必要的唤醒，但不会出错。
+    while (state_.exchange(2, std::memory_order_acquire) != 0) {
+      wait(2);
+    }
+  }
+
+  void unlock() {
+    // 如果状态是 1，说明没有线程在睡眠，不需要系统调用。
+    if (state_.exchange(0, std::memory_order_release) == 2) {
+      wake_one();
+    }
+  }
+
+private:
+#ifdef __linux__
+  // 如果 state_ 仍然等于 expected，就睡眠，直到被 wake_one 唤醒（也可能被虚假唤醒）。
+  // 检查和睡眠由内核原子地完成，所以不会错过在两者之间发生的唤醒。
+  void wait(int expected) {
+    syscall(SYS_futex, reinterpret_cast<int *>(&state_), FUTEX_WAIT_PRIVATE, expected, nullptr,
+            nullptr, 0);
+  }
+  void wake_one() {
+    syscall(SYS_futex, reinterpret_cast<int *>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr,
+            0);
+  }
+#else
+  void wait(int) { std::this_thread::yield(); }
+  void wake_one() {}
+#endif
+
+  // futex 系统调用直接操作 state_ 所在的 4 个字节。
+  static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex needs a plain 32-bit word");
+  std::atomic<int> state_{0};
+};
+
+// 与 scoped_lock.cpp 中相同的全局 count 和 add_count 函数，只是把 std::mutex 换成了 SpinFutexMutex。
+int count = 0;
+SpinFutexMutex m;
+
+void add_count() {
+  std::scoped_lock slk(m);
+  count += 1;
+}
+
+// 基准测试的结果：吞吐量和获取锁的延迟分布。
+struct Result {
+  double mops;
+  double p50_ns;
+  double p99_ns;
+};
+
+// threads 个线程各执行 ops_per_thread 次"获取锁、count += 1、释放锁，再做 work 次空循环"。
+// work 越小，线程在锁上的争用越激烈。每 16 次获取锁测量一次等待时间。
+template <typename Mutex> Result run(int threads, int ops_per_thread, int work) {
+  Mutex mutex;
+  long long counter = 0;
+  std::vector<std::vector<double>> samples(threads);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      auto &mine = samples[t];
+      for (int i = 0; i < ops_per_thread; ++i) {
+        if (i % 16 == 0) {
+          auto before = std::chrono::steady_clock::now();
+          mutex.lock();
+          std::chrono::duration<double, std::nano> waited =
+              std::chrono::steady_clock::now() - before;
+          mine.push_back(waited.count());
+        } else {
+          mutex.lock();
+        }
+        counter += 1;
+        mutex.unlock();
+        for (volatile int w = 0; w < work; w = w + 1) {
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (counter != static_cast<long long>(threads) * ops_per_thread) {
+    std::cout << "Lost updates!\n";
+  }
+  std::vector<double> all;
+  for (auto &s : samples) {
+    all.insert(all.end(), s.begin(), s.end());
+  }
+  std::sort(all.begin(), all.end());
+  return {threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6,
+          all[all.size() / 2], all[all.size() * 99 / 100]};
+}
+
+int main() {
+  // 首先，我们像 scoped_lock.cpp 中那样让两个线程各调用一次 add_count。
+  std::thread t1(add_count);
+  std::thread t2(add_count);
+  t1.join();
+  t2.join();
+  std::cout << "Printing count: " << count << std::endl;
+
+  // SpinFutexMutex 同样可以和 std::unique_lock 一起使用。
+  {
+    std::unique_lock lk(m, std::try_to_lock);
+    std::cout << "try_to_lock succeeded: " << lk.owns_lock() << "\n";
+  }
+
+  // 基准测试：不同争用程度下 std::mutex 和 SpinFutexMutex 的吞吐量，以及获取锁的等待时间
+  // 的中位数和 99 分位数。
+  // 注意：在核数很少的机器上，线程不能真正并行执行，持有锁的线程被抢占时自旋只是在浪费时间片，
+  // 这种情况下自旋锁的优势不明显；需要在多核机器上运行才能看到自旋避免睡眠带来的收益。
+  const int ops_per_thread = 200000;
+  std::cout << "threads  work  std::mutex Mops/s p50/p99(ns)   SpinFutexMutex Mops/s p50/p99(ns)\n";
+  for (int work : {0, 100}) {
+    for (int threads : {1, 2, 4, 8}) {
+      Result a = run<std::mutex>(threads, ops_per_thread, work);
+      Result b = run<SpinFutexMutex>(threads, ops_per_thread, work);
+      std::cout << threads << "        " << work << "    " << a.mops << " " << a.p50_ns << "/"
+                << a.p99_ns << "    " << b.mops << " " << b.p50_ns << "/" << b.p99_ns << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+// mutex.cpp、scoped_lock.cpp 和 condition_variable.cpp 中的线程都在一把 std::mutex 的保护下
+// 给同一个全局变量 count 加一。只有两个线程各加一次时这没有问题，但如果很多线程频繁地加一，
+// 所有线程都在争抢同一把锁，锁和 count 所在的缓存行在各个核之间来回传递，
+// 线程越多，每次加一反而越慢。把 count 换成 std::atomic<int> 可以去掉锁，
+// 但所有线程仍然在修改同一个缓存行，问题只是减轻了。
+
+// 这个文件实现一个分片（striped）计数器 StripedCounter：
+//   - 计数器由多个槽（slot）组成，每个槽独占一个缓存行（64 字节），避免伪共享（false sharing）；
+//   - 每个线程第一次使用计数器时被分配到一个槽，之后只修改自己的槽，
+//     使用 std::memory_order_relaxed 的 fetch_add，不需要任何锁，也不和其他线程争抢缓存行；
+//   - 读取时把所有槽加起来。读取比较慢（要访问每个槽），但"写多读少"的计数器正适合这种取舍。
+// 注意：read() 不是一个原子快照，它和并发的 add() 同时执行时，结果可能包含也可能不包含
+// 某些正在进行的加法；但在所有写线程结束（例如 join）之后，read() 总是准确的。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono 库头文件，用于基准测试计时。
+#include <chrono>
+// 包含 std::cout（打印）用于演示目的。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含mutex库头文件。
+#include <mutex>
+// 包含thread库头文件。
+#include <thread>
+// 包含 std::vector 库头文件。
+#include <vector>
+
+// 缓存行大小。C++17 提供了 std::hardware_destructive_interference_size，
+// 但并不是所有标准库都实现了它，所以这里直接使用常见的 64 字节。
+constexpr size_t kCacheLineSize = 64;
+
+class StripedCounter {
+  // 每个槽独占一个缓存行。
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<long long> value{0};
+  };
+
+public:
+  // slot_count 会被向上取整为 2 的幂。默认槽数是硬件线程数的两倍，
+  // 这样即使线程数稍多于核数，也很少有两个线程共用一个槽。
+  explicit StripedCounter(size_t slot_count = 2 * std::thread::hardware_concurrency()) {
+    size_t count = 1;
+    while (count < slot_count) {
+      count *= 2;
+    }
+    mask_ = count - 1;
+    slots_.reset(new Slot[count]);
+  }
+
+  StripedCounter(const StripedCounter &) = delete;
+  StripedCounter &operator=(const StripedCounter &) = delete;
+
+  void add(long long delta) {
+    slots_[thread_index() & mask_].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  void increment() { add(1); }
+
+  // 把所有槽加起来。
+  long long read() const {
+    long long total = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+      total += slots_[i].value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  size_t slot_count() const { return mask_ + 1; }
+
+private:
+  // 每个线程的编号，在线程第一次使用任何 StripedCounter 时按顺序分配。
+  // 按顺序分配（而不是对线程 id 取哈希）保证前 slot_count 个线程一定落在不同的槽上。
+  static size_t thread_index() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+  size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+// 与 mutex.cpp 中相同的全局 count 和 mutex，以及 add_count 函数。
+int count = 0;
+std::mutex m;
+
+void add_count() {
+  m.lock();
+  count += 1;
+  m.unlock();
+}
+
+// 同样的计数器，用 std::atomic<int> 实现。
+std::atomic<int> atomic_count{0};
+
+void atomic_add_count() { atomic_count.fetch_add(1, std::memory_order_relaxed); }
+
+// 用分片计数器实现。
+StripedCounter striped_count;
+
+void striped_add_count() { striped_count.increment(); }
+
+// 启动 threads 个线程，每个线程调用 fn ops_per_thread 次，返回吞吐量（百万次操作/秒）。
+template <typename Fn> double run(int threads, int ops_per_thread, Fn fn) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&]() {
+      for (int i = 0; i < ops_per_thread; ++i) {
+        fn();
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return threads * static_cast<double>(ops_per_thread) / elapsed.count() / 1e6;
+}
+
+int main() {
+  // 首先，我们像 mutex.cpp 中那样让两个线程各加一次。
+  std::thread t1(striped_add_count);
+  std::thread t2(striped_add_count);
+  t1.join();
+  t2.join();
+  std::cout << "Printing count: " << striped_count.read() << " (" << striped_count.slot_count()
+            << " slots)\n";
+
+  // 基准测试：threads 个线程各加 ops_per_thread 次，比较三种计数器的吞吐量，
+  // 并检查最终的计数是否正确。
+  // 注意：在核数很少的机器上，线程不能真正并行执行，看不到分片计数器随核数扩展的效果；
+  // 需要在多核机器上运行才能看到 mutex 和 std::atomic 的吞吐量随线程数下降。
+  const int ops_per_thread = 500000;
+  std::cout << "threads  mutex(Mops/s)  atomic(Mops/s)  striped(Mops/s)\n";
+  bool ok = true;
+  for (int threads : {1, 2, 4, 8, 16}) {
+    count = 0;
+    atomic_count = 0;
+    StripedCounter counter;
+    double a = run(threads, ops_per_thread, add_count);
+    double b = run(threads, ops_per_thread, atomic_add_count);
+    double c = run(threads, ops_per_thread, [&counter]() { counter.increment(); });
+    long long expected = static_cast<long long>(threads) * ops_per_thread;
+    ok = ok && count == expected && atomic_count == expected && counter.read() == expected;
+    std::cout << threads << "        " << a << "        " << b << "        " << c << "\n";
+  }
+  std::cout << "All counts correct: " << (ok ? "yes" : "NO") << "\n";
+
+  return 0;
+}